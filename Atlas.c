@@ -0,0 +1,227 @@
+/**
+@file Atlas.c
+@author Rob Thomas
+@brief Contains functions for rendering an atlas: a grid of small Julia set
+thumbnails, each with a different complex constant C.
+*/
+
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "Drawing.h"
+#include "HelperFunctions.h"
+#include "JuliaSet.h"
+
+#include "Atlas.h"
+
+
+/**
+@def ATLAS_ARGS
+@brief The number of command line arguments (including the program name and
+--atlas) that runAtlas() requires.
+*/
+#define ATLAS_ARGS 11
+
+
+/**
+@fn partialAtlas
+@brief Computes the groups of JULIA_LANES neighbouring thumbnails that belong
+to one thread.
+@param data A void pointer to be cast into an AtlasData struct.
+*/
+int partialAtlas (void *data)
+{
+	AtlasData *d = (AtlasData*)data;
+	long thumbnailSize = d->thumbnail.windowWidth;
+	long groupsPerRow = (d->columns + JULIA_LANES - 1) / JULIA_LANES;
+	long numGroups = groupsPerRow * d->rows;
+
+	for (long group = d->threadID; group < numGroups; 
+		 group += d->numberOfThreads)
+	{
+		long row = group / groupsPerRow;
+		long firstColumn = (group % groupsPerRow) * JULIA_LANES;
+
+		double complex C[JULIA_LANES];
+		long xOffset[JULIA_LANES], yOffset[JULIA_LANES];
+
+		for (int lane = 0; lane < JULIA_LANES; lane++)
+		{
+			long column = firstColumn + lane;
+
+			/* Lanes past the last column repeat the last thumbnail but are not
+			   stored. */
+			if (column >= d->columns)
+			{
+				C[lane] = C[0];
+				xOffset[lane] = -1;
+				yOffset[lane] = -1;
+				continue;
+			}
+
+			C[lane] = (d->minA + (column + 0.5) * d->deltaA) + 
+					  (d->maxB - (row + 0.5) * d->deltaB) * I;
+			xOffset[lane] = column * thumbnailSize;
+			yOffset[lane] = row * thumbnailSize;
+		}
+
+		fillJuliaLanes(&d->thumbnail, C, d->colorMap, xOffset, yOffset, 0, 0,
+					   thumbnailSize, thumbnailSize);
+	}
+
+	return 0;
+}
+
+/**
+@fn runAtlas
+@brief Renders an atlas and writes it to disk.
+@details runAtlas() is called as
+	Project04_01 --atlas columns rows thumbnailSize minA minB maxA maxB 
+					   numberOfThreads outputFile [--map=NAME]
+where columns x rows thumbnails of thumbnailSize x thumbnailSize pixels sample
+C over the rectangle from minA + minB*i to maxA + maxB*i.
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if the atlas was written.
+*/
+int runAtlas (int argc, char *argv[], int numIterations)
+{
+	/*** Read in command line arguments. ***/
+	if (argc < ATLAS_ARGS)
+	{
+		fprintf(stderr, "Usage: %s --atlas columns rows thumbnailSize minA minB "
+				"maxA maxB numberOfThreads outputFile [--map=NAME]\n", argv[0]);
+
+		return INSUFFICIENT_ARGS_FAIL;
+	}
+
+	double values[8];
+
+	for (int i = 0; i < 8; i++)
+	{
+		char *endptr = NULL;
+
+		values[i] = strtod(argv[i + 2], &endptr);
+
+		if (endptr == argv[i + 2] || *endptr != '\0')
+		{
+			fprintf(stderr, "Non-number arg given. All args must be numbers.\n");
+
+			return ARG_NOT_A_NUMBER_FAIL;
+		}
+	}
+
+	long columns = (long)values[0];
+	long rows = (long)values[1];
+	long thumbnailSize = (long)values[2];
+	long numberOfThreads = (long)values[7];
+
+	if (columns <= 0 || rows <= 0 || thumbnailSize <= 0 || numberOfThreads <= 0)
+	{
+		fprintf(stderr, "Grid size, thumbnail size and number of threads must "
+				"be greater than 0.\n");
+
+		return ARG_BELOW_ONE_FAIL;
+	}
+
+	RenderOptions options;
+	int result = getOptions(argc, argv, ATLAS_ARGS, &options);
+
+	if (result)
+	{
+		return result;
+	}
+	if (options.coloring != COLOR_ESCAPE_TIME)
+	{
+		fprintf(stderr, "Atlas mode only supports coloring by escape time.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+	if (options.renderer == RENDERER_INVERSE)
+	{
+		fprintf(stderr, "Atlas mode only supports the escape-time renderer.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+	if (options.kernel != KERNEL_AUTO || options.tileColumns != 0)
+	{
+		fprintf(stderr, "Atlas mode always uses its lane kernel, so it does not "
+				"support --kernel or --tile.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+
+	/*** Describe the atlas. ***/
+	long windowWidth = columns * thumbnailSize;
+	long windowHeight = rows * thumbnailSize;
+	SDL_Color **colorMap = newColorMap(windowWidth, windowHeight);
+
+	AtlasData base;
+
+	base.thumbnail.centerX = 0.0;
+	base.thumbnail.centerY = 0.0;
+	base.thumbnail.planeWidth = ATLAS_PLANE_SIZE;
+	base.thumbnail.planeHeight = ATLAS_PLANE_SIZE;
+	base.thumbnail.C = 0.0;
+	base.thumbnail.windowWidth = thumbnailSize;
+	base.thumbnail.windowHeight = thumbnailSize;
+	base.thumbnail.numIterations = numIterations;
+	base.thumbnail.map = options.map;
+	base.thumbnail.coloring = COLOR_ESCAPE_TIME;
+	base.thumbnail.renderer = RENDERER_ESCAPE_TIME;
+	base.thumbnail.kernel = KERNEL_SCALAR;
+	base.columns = columns;
+	base.rows = rows;
+	base.minA = values[3];
+	base.maxB = values[6];
+	base.deltaA = (values[5] - values[3]) / columns;
+	base.deltaB = (values[6] - values[4]) / rows;
+	base.numberOfThreads = (int)numberOfThreads;
+	base.colorMap = colorMap;
+
+	SDL_Thread *threadList[numberOfThreads];
+	AtlasData dataList[numberOfThreads];
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		dataList[threadID] = base;
+		dataList[threadID].threadID = threadID;
+	}
+
+	/*** Compute the atlas. ***/
+	Uint32 startTime = SDL_GetTicks();
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		threadList[threadID] = SDL_CreateThread(partialAtlas, "Atlas Thread",
+												(void*)&(dataList[threadID]));
+	}
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		SDL_WaitThread(threadList[threadID], NULL);
+	}
+
+	Uint32 endTime = SDL_GetTicks();
+
+	printf("Processing time: %dms\n", endTime - startTime);
+
+	/*** Write the atlas. ***/
+	bool written = writeColorMap(argv[10], colorMap, windowWidth, windowHeight);
+
+	freeColorMap(colorMap, windowWidth, windowHeight);
+
+	if (!written)
+	{
+		fprintf(stderr, "Could not write '%s'.\n", argv[10]);
+
+		return ATLAS_WRITE_FAIL;
+	}
+
+	return GET_ARGS_SUCCEED;
+}
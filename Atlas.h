@@ -0,0 +1,73 @@
+/**
+@file Atlas.h
+@author Rob Thomas
+@brief Contains functions for rendering an atlas: a grid of small Julia set
+thumbnails, each with a different complex constant C.
+*/
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <complex.h>
+#include <SDL2/SDL.h>
+
+#include "HelperFunctions.h"
+
+
+/**
+@def ATLAS_WRITE_FAIL
+@brief Error code indicating that the atlas could not be written to disk.
+*/
+#define ATLAS_WRITE_FAIL 8
+
+/**
+@def ATLAS_PLANE_SIZE
+@brief The width and height (in units) of the slice of the complex plane shown
+by every thumbnail. It covers the disk of radius 2 that holds every quadratic
+Julia set.
+*/
+#define ATLAS_PLANE_SIZE 4.0
+
+
+/**
+@typedef AtlasData
+@brief The AtlasData struct is used for transmitting the description of an
+atlas to the threads that compute it.
+@details The thumbnail in column i and row j shows the Julia set of
+C = (minA + (i + 0.5) * deltaA) + (maxB - (j + 0.5) * deltaB) * I, so C grows
+to the right and upwards like the complex plane.
+*/
+typedef struct AtlasData
+{
+	JuliaParams thumbnail;
+	long columns, rows;
+	double minA, maxB, deltaA, deltaB;
+	int threadID, numberOfThreads;
+	SDL_Color **colorMap;
+} AtlasData;
+
+
+/**
+@fn runAtlas
+@brief Renders an atlas and writes it to disk.
+@details runAtlas() is called as
+	Project04_01 --atlas columns rows thumbnailSize minA minB maxA maxB 
+					   numberOfThreads outputFile [--map=NAME]
+where columns x rows thumbnails of thumbnailSize x thumbnailSize pixels sample
+C over the rectangle from minA + minB*i to maxA + maxB*i.
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if the atlas was written.
+*/
+int runAtlas (int argc, char *argv[], int numIterations);
+
+/**
+@fn partialAtlas
+@brief Computes the groups of JULIA_LANES neighbouring thumbnails that belong
+to one thread.
+@param data A void pointer to be cast into an AtlasData struct.
+*/
+int partialAtlas (void *data);
+
+#endif /* ATLAS_H */
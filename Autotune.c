@@ -0,0 +1,351 @@
+/**
+@file Autotune.c
+@author Rob Thomas
+@brief Contains functions for measuring which number of threads, tile size
+and kernel render fastest on this machine, and for keeping the result in a
+profile file.
+*/
+
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "Drawing.h"
+#include "HelperFunctions.h"
+#include "JuliaSet.h"
+
+#include "Autotune.h"
+
+
+/**
+@typedef TuneView
+@brief The TuneView struct describes one of the views rendered while tuning.
+*/
+typedef struct TuneView
+{
+	double centerX, centerY, planeWidth, planeHeight;
+	double a, b;
+	JuliaMap map;
+} TuneView;
+
+/* Views with little and much work per pixel, and with work that is spread
+   evenly or bunched up in a few columns, so that no one setting is favored
+   by a lucky view. */
+static const TuneView tuneViews[] =
+{
+	{ 0.0, 0.0, 4.0, 3.0, -0.8, 0.156, MAP_QUADRATIC },
+	{ -0.1, 0.651, 0.04, 0.03, -0.8, 0.156, MAP_QUADRATIC },
+	{ 0.0, 0.0, 4.0, 3.0, 0.285, 0.01, MAP_QUADRATIC },
+	{ 0.0, 0.0, 4.0, 3.0, 0.285, 0.01, MAP_POWER3 }
+};
+
+/**
+@def NUM_TUNE_VIEWS
+@brief The number of views rendered while tuning.
+*/
+#define NUM_TUNE_VIEWS ((int)(sizeof(tuneViews) / sizeof(tuneViews[0])))
+
+/**
+@fn kernelName
+@brief Gives the name of a kernel, as used by --kernel and profile files.
+@param kernel The kernel.
+@return The name of the kernel.
+*/
+static const char * kernelName (JuliaKernel kernel)
+{
+	return (kernel == KERNEL_VECTOR) ? "vector" : "scalar";
+}
+
+/**
+@fn readTuneProfile
+@brief Reads a profile file written by runAutotune().
+@param fileName The name of the profile file.
+@param profile Pointer to where the profile is stored.
+@return true if the file exists and holds a valid profile, false otherwise.
+*/
+bool readTuneProfile (const char *fileName, TuneProfile *profile)
+{
+	FILE *file = fopen(fileName, "r");
+
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	char line[256];
+	char kernel[16] = "";
+
+	profile->numberOfThreads = 0;
+	profile->tileColumns = 0;
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		/* Lines that are not settings (such as comments) are skipped. */
+		if (sscanf(line, "threads %ld", &profile->numberOfThreads) != 1 &&
+			sscanf(line, "tile %ld", &profile->tileColumns) != 1)
+		{
+			sscanf(line, "kernel %15s", kernel);
+		}
+	}
+
+	fclose(file);
+
+	if (strcmp(kernel, "scalar") == 0)
+	{
+		profile->kernel = KERNEL_SCALAR;
+	}
+	else if (strcmp(kernel, "vector") == 0)
+	{
+		profile->kernel = KERNEL_VECTOR;
+	}
+	else
+	{
+		return false;
+	}
+
+	return profile->numberOfThreads > 0 && profile->tileColumns > 0;
+}
+
+/**
+@fn writeTuneProfile
+@brief Writes a profile file.
+@param fileName The name of the profile file.
+@param profile The profile to be written.
+@return true if the file was written, false otherwise.
+*/
+bool writeTuneProfile (const char *fileName, const TuneProfile *profile)
+{
+	FILE *file = fopen(fileName, "w");
+
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	fprintf(file, "# Written by Project04_01 --autotune\n");
+	fprintf(file, "threads %ld\n", profile->numberOfThreads);
+	fprintf(file, "tile %ld\n", profile->tileColumns);
+	fprintf(file, "kernel %s\n", kernelName(profile->kernel));
+
+	bool written = !ferror(file);
+
+	return (fclose(file) == 0) && written;
+}
+
+/**
+@fn timeSetting
+@brief Renders every tuning view with one setting and measures how long it
+takes.
+@param setting The number of threads, tile size and kernel to render with.
+@param colorMap A color map of AUTOTUNE_WIDTH x AUTOTUNE_HEIGHT pixels.
+@param dataList Room for the data packets of setting->numberOfThreads
+threads.
+@param numIterations The number of iterations to apply to each point.
+@return The fastest time (in milliseconds) of AUTOTUNE_REPEATS renders of
+all the views.
+*/
+static double timeSetting (const TuneProfile *setting, SDL_Color **colorMap,
+						   ThreadData dataList[], int numIterations)
+{
+	SDL_Thread *threadList[setting->numberOfThreads];
+	OrbitState **orbitMap = NULL;
+	double fastest = 0.0;
+
+	for (int repeat = 0; repeat < AUTOTUNE_REPEATS; repeat++)
+	{
+		Uint64 ticks = 0;
+
+		for (int view = 0; view < NUM_TUNE_VIEWS; view++)
+		{
+			/*** Set up the threads as main() would for this view. ***/
+			for (int threadID = 0; threadID < setting->numberOfThreads;
+				 threadID++)
+			{
+				ThreadData *d = &dataList[threadID];
+
+				d->params.centerX = tuneViews[view].centerX;
+				d->params.centerY = tuneViews[view].centerY;
+				d->params.planeWidth = tuneViews[view].planeWidth;
+				d->params.planeHeight = tuneViews[view].planeHeight;
+				d->params.C = tuneViews[view].a + tuneViews[view].b * I;
+				d->params.windowWidth = AUTOTUNE_WIDTH;
+				d->params.windowHeight = AUTOTUNE_HEIGHT;
+				d->params.numIterations = numIterations;
+				d->params.map = tuneViews[view].map;
+				d->params.coloring = COLOR_ESCAPE_TIME;
+				d->params.renderer = RENDERER_ESCAPE_TIME;
+				d->params.kernel = setting->kernel;
+				d->threadID = threadID;
+				d->numberOfThreads = (int)setting->numberOfThreads;
+				d->pinning = PIN_NONE;
+				d->chunkColumns = setting->tileColumns;
+				d->colorMapPtr = &colorMap;
+				d->orbitMapPtr = &orbitMap;
+				d->tiles = NULL;
+				d->generation = NULL;
+				d->renderGeneration = 0;
+				d->finishedColumns = NULL;
+			}
+
+			/*** Render it. ***/
+			Uint64 startTime = SDL_GetPerformanceCounter();
+
+			for (int threadID = 0; threadID < setting->numberOfThreads;
+				 threadID++)
+			{
+				threadList[threadID] = SDL_CreateThread(partialFill,
+														"Tuning Thread",
+														&dataList[threadID]);
+			}
+			for (int threadID = 0; threadID < setting->numberOfThreads;
+				 threadID++)
+			{
+				SDL_WaitThread(threadList[threadID], NULL);
+			}
+
+			ticks += SDL_GetPerformanceCounter() - startTime;
+		}
+
+		double time = (double)ticks * 1000.0 / SDL_GetPerformanceFrequency();
+
+		if (repeat == 0 || time < fastest)
+		{
+			fastest = time;
+		}
+	}
+
+	return fastest;
+}
+
+/**
+@fn trySetting
+@brief Times a setting and keeps it if it beats the best one so far by at
+least AUTOTUNE_MARGIN.
+@param setting The setting to try.
+@param best The best setting so far, replaced by setting if it is faster.
+@param bestTime The time of the best setting, or 0 if there is none yet.
+@param colorMap A color map of AUTOTUNE_WIDTH x AUTOTUNE_HEIGHT pixels.
+@param dataList Room for the data packets of setting->numberOfThreads
+threads.
+@param numIterations The number of iterations to apply to each point.
+*/
+static void trySetting (const TuneProfile *setting, TuneProfile *best,
+						double *bestTime, SDL_Color **colorMap,
+						ThreadData dataList[], int numIterations)
+{
+	double time = timeSetting(setting, colorMap, dataList, numIterations);
+
+	printf("  threads %ld, tile %ld, kernel %s: %.1fms\n",
+		   setting->numberOfThreads, setting->tileColumns,
+		   kernelName(setting->kernel), time);
+
+	if (*bestTime == 0.0 || time < *bestTime * (1.0 - AUTOTUNE_MARGIN))
+	{
+		*best = *setting;
+		*bestTime = time;
+	}
+}
+
+/**
+@fn runAutotune
+@brief Measures the fastest settings for this machine and writes them to
+AUTOTUNE_PROFILE_FILE.
+@details runAutotune() is called as
+	Project04_01 --autotune
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if the profile was written.
+*/
+int runAutotune (int argc, char *argv[], int numIterations)
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "Usage: %s --autotune\n", argv[0]);
+
+		return INSUFFICIENT_ARGS_FAIL;
+	}
+
+	/* Try up to twice as many threads as CPUs, in case the CPUs run more
+	   than one thread each. */
+	long numCPUs = SDL_GetCPUCount();
+	long maxThreads = 2 * ((numCPUs > 0) ? numCPUs : 1);
+	SDL_Color **colorMap = newColorMap(AUTOTUNE_WIDTH, AUTOTUNE_HEIGHT);
+	ThreadData *dataList = (ThreadData*)malloc(maxThreads *
+											   sizeof(ThreadData));
+
+	if (colorMap == NULL || dataList == NULL)
+	{
+		fprintf(stderr, "Not enough memory to tune.\n");
+		free(dataList);
+
+		if (colorMap != NULL)
+		{
+			freeColorMap(colorMap, AUTOTUNE_WIDTH, AUTOTUNE_HEIGHT);
+		}
+
+		return AUTOTUNE_FAIL;
+	}
+
+	TuneProfile best = { 1, 1, KERNEL_SCALAR };
+	TuneProfile setting = best;
+	double bestTime = 0.0;
+
+	/*** Kernel, on one thread. ***/
+	printf("Kernel:\n");
+	trySetting(&setting, &best, &bestTime, colorMap, dataList, numIterations);
+	setting.kernel = KERNEL_VECTOR;
+	trySetting(&setting, &best, &bestTime, colorMap, dataList, numIterations);
+
+	/*** Number of threads: powers of two, and the number of CPUs. ***/
+	printf("Threads:\n");
+	setting = best;
+
+	for (long threads = 2; threads <= maxThreads; threads *= 2)
+	{
+		if (numCPUs > threads / 2 && numCPUs < threads)
+		{
+			setting.numberOfThreads = numCPUs;
+			trySetting(&setting, &best, &bestTime, colorMap, dataList,
+					   numIterations);
+		}
+
+		setting.numberOfThreads = threads;
+		trySetting(&setting, &best, &bestTime, colorMap, dataList,
+				   numIterations);
+	}
+
+	/*** Tile size, with that many threads. ***/
+	printf("Tile size:\n");
+	setting = best;
+
+	for (long columns = 2; columns <= AUTOTUNE_MAX_TILE; columns *= 2)
+	{
+		setting.tileColumns = columns;
+		trySetting(&setting, &best, &bestTime, colorMap, dataList,
+				   numIterations);
+	}
+
+	freeColorMap(colorMap, AUTOTUNE_WIDTH, AUTOTUNE_HEIGHT);
+	free(dataList);
+
+	printf("Fastest: threads %ld, tile %ld, kernel %s (%.1fms)\n",
+		   best.numberOfThreads, best.tileColumns, kernelName(best.kernel),
+		   bestTime);
+
+	if (!writeTuneProfile(AUTOTUNE_PROFILE_FILE, &best))
+	{
+		fprintf(stderr, "Could not write '%s'.\n", AUTOTUNE_PROFILE_FILE);
+
+		return AUTOTUNE_FAIL;
+	}
+
+	printf("Wrote '%s'.\n", AUTOTUNE_PROFILE_FILE);
+
+	return GET_ARGS_SUCCEED;
+}
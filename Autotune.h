@@ -0,0 +1,123 @@
+/**
+@file Autotune.h
+@author Rob Thomas
+@brief Contains functions for measuring which number of threads, tile size
+and kernel render fastest on this machine, and for keeping the result in a
+profile file.
+@details runAutotune() renders a few representative views with every
+candidate setting, one setting at a time: first the kernel (on one thread),
+then the number of threads with that kernel, then the tile size with that
+number of threads. A larger or fancier setting only replaces the current one
+if it is at least AUTOTUNE_MARGIN faster, so timing noise does not pick more
+threads than help. The result is written to AUTOTUNE_PROFILE_FILE, a short
+text file such as
+
+	threads 8
+	tile 4
+	kernel vector
+
+which main() reads on every later start to fill in "auto" for the number of
+threads and any --kernel or --tile that is not given. Batch mode takes the
+kernel of its jobs from it the same way. The archive, pyramid, atlas and zoom
+modes have tiles and kernels of their own, so they do not read it and reject
+--kernel and --tile.
+*/
+
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stdbool.h>
+
+#include "HelperFunctions.h"
+
+
+/**
+@def AUTOTUNE_FAIL
+@brief Error code indicating that the settings could not be measured or the
+profile file could not be written.
+*/
+#define AUTOTUNE_FAIL 16
+
+/**
+@def AUTOTUNE_PROFILE_FILE
+@brief The name of the profile file, in the working directory.
+*/
+#define AUTOTUNE_PROFILE_FILE "julia.profile"
+
+/**
+@def AUTOTUNE_WIDTH
+@brief The width (in pixels) of the views rendered while tuning.
+*/
+#define AUTOTUNE_WIDTH 640
+
+/**
+@def AUTOTUNE_HEIGHT
+@brief The height (in pixels) of the views rendered while tuning.
+*/
+#define AUTOTUNE_HEIGHT 480
+
+/**
+@def AUTOTUNE_REPEATS
+@brief How many times each setting is timed. The fastest time counts.
+*/
+#define AUTOTUNE_REPEATS 3
+
+/**
+@def AUTOTUNE_MAX_TILE
+@brief The largest tile size (in columns) that is tried.
+*/
+#define AUTOTUNE_MAX_TILE 64
+
+/**
+@def AUTOTUNE_MARGIN
+@brief How much faster (as a fraction) a setting must be to replace a smaller
+one.
+*/
+#define AUTOTUNE_MARGIN 0.03
+
+
+/**
+@typedef TuneProfile
+@brief The TuneProfile struct holds the settings that render fastest on this
+machine.
+*/
+typedef struct TuneProfile
+{
+	long numberOfThreads;
+	long tileColumns;
+	JuliaKernel kernel;
+} TuneProfile;
+
+
+/**
+@fn readTuneProfile
+@brief Reads a profile file written by runAutotune().
+@param fileName The name of the profile file.
+@param profile Pointer to where the profile is stored.
+@return true if the file exists and holds a valid profile, false otherwise.
+*/
+bool readTuneProfile (const char *fileName, TuneProfile *profile);
+
+/**
+@fn writeTuneProfile
+@brief Writes a profile file.
+@param fileName The name of the profile file.
+@param profile The profile to be written.
+@return true if the file was written, false otherwise.
+*/
+bool writeTuneProfile (const char *fileName, const TuneProfile *profile);
+
+/**
+@fn runAutotune
+@brief Measures the fastest settings for this machine and writes them to
+AUTOTUNE_PROFILE_FILE.
+@details runAutotune() is called as
+	Project04_01 --autotune
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if the profile was written.
+*/
+int runAutotune (int argc, char *argv[], int numIterations);
+
+#endif /* AUTOTUNE_H */
@@ -0,0 +1,389 @@
+/**
+@file Batch.c
+@author Rob Thomas
+@brief Contains functions for rendering many Julia set images, described by a
+job file, in a single process.
+*/
+
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "Autotune.h"
+#include "Drawing.h"
+#include "HelperFunctions.h"
+#include "JuliaSet.h"
+
+#include "Batch.h"
+
+
+/**
+@fn parseNumber
+@brief Converts a whole string into a double.
+@param text The string to convert.
+@param value Pointer to where the number will be stored.
+@return true if text is a number, false otherwise.
+*/
+static bool parseNumber (const char *text, double *value)
+{
+	char *endptr = NULL;
+
+	*value = strtod(text, &endptr);
+
+	return (endptr != text && *endptr == '\0');
+}
+
+/**
+@fn parseJob
+@brief Reads one job from a line of a job file.
+@param line The line to read. It is modified while it is split into fields.
+@param numIterations The number of iterations to apply to each point.
+@param kernel The kernel used when the line has no --kernel option.
+@param job Pointer to where the job will be stored.
+@return An error code. 0 if the line describes a valid job.
+*/
+static int parseJob (char *line, int numIterations, JuliaKernel kernel,
+					 BatchJob *job)
+{
+	char *tokens[MAX_JOB_TOKENS];
+	int numTokens = 0;
+
+	/*** Split the line into whitespace separated fields. ***/
+	for (char *token = strtok(line, " \t\r\n"); token != NULL; 
+		 token = strtok(NULL, " \t\r\n"))
+	{
+		if (numTokens == MAX_JOB_TOKENS)
+		{
+			return INSUFFICIENT_ARGS_FAIL;
+		}
+
+		tokens[numTokens++] = token;
+	}
+
+	if (numTokens < 9)
+	{
+		return INSUFFICIENT_ARGS_FAIL;
+	}
+
+	/*** Read in the eight numbers. ***/
+	double values[8];
+
+	for (int i = 0; i < 8; i++)
+	{
+		if (!parseNumber(tokens[i], &values[i]))
+		{
+			return ARG_NOT_A_NUMBER_FAIL;
+		}
+	}
+
+	if (values[0] < 1.0 || values[1] < 1.0 || values[2] <= 0.0 || 
+		values[3] <= 0.0)
+	{
+		return ARG_BELOW_ONE_FAIL;
+	}
+
+	/*** Read in the options that follow the output file. ***/
+	RenderOptions options;
+	int result = getOptions(numTokens, tokens, 9, &options);
+
+	if (result)
+	{
+		return result;
+	}
+	if (options.renderer == RENDERER_INVERSE)
+	{
+		fprintf(stderr, "Batch mode only supports the escape-time renderer.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+	if (options.tileColumns != 0)
+	{
+		fprintf(stderr, "Batch mode splits jobs into pieces of its own, so it "
+				"does not support --tile.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+
+	job->params.windowWidth = (long)values[0];
+	job->params.windowHeight = (long)values[1];
+	job->params.planeWidth = values[2];
+	job->params.planeHeight = values[3];
+	job->params.centerX = values[4];
+	job->params.centerY = values[5];
+	job->params.C = values[6] + values[7] * I;
+	job->params.numIterations = numIterations;
+	job->params.map = options.map;
+	job->params.coloring = options.coloring;
+	job->params.renderer = RENDERER_ESCAPE_TIME;
+	job->params.kernel = (options.kernel == KERNEL_AUTO) ? kernel :
+						  options.kernel;
+
+	strcpy(job->outputFile, tokens[8]);
+
+	job->colorMap = NULL;
+	job->lock = 0;
+	job->failed = false;
+
+	return GET_ARGS_SUCCEED;
+}
+
+/**
+@fn readJobFile
+@brief Reads the jobs described by a job file. Jobs without --kernel use the
+kernel in AUTOTUNE_PROFILE_FILE (see Autotune.h), or the scalar one if there
+is no profile.
+@param fileName The name of the job file.
+@param numIterations The number of iterations to apply to each point.
+@param jobs Pointer to where the dynamically allocated list of jobs will be 
+stored.
+@param numJobs Pointer to where the number of jobs will be stored.
+@return An error code. 0 if every job was read.
+*/
+int readJobFile (const char *fileName, int numIterations, BatchJob **jobs,
+				 int *numJobs)
+{
+	FILE *jobFile = fopen(fileName, "r");
+
+	if (jobFile == NULL)
+	{
+		fprintf(stderr, "Could not open job file '%s'.\n", fileName);
+
+		return BATCH_FILE_FAIL;
+	}
+
+	/* Jobs without --kernel use the one measured by --autotune, if any. */
+	TuneProfile profile;
+	JuliaKernel kernel = readTuneProfile(AUTOTUNE_PROFILE_FILE, &profile) ?
+						 profile.kernel : KERNEL_SCALAR;
+
+	char line[MAX_JOB_LINE];
+	int capacity = 64;
+	int lineNumber = 0;
+
+	*jobs = (BatchJob*)malloc(sizeof(BatchJob) * capacity);
+	*numJobs = 0;
+
+	while (fgets(line, sizeof(line), jobFile) != NULL)
+	{
+		lineNumber++;
+
+		/* Skip comments and empty lines. */
+		size_t start = strspn(line, " \t\r\n");
+
+		if (line[start] == '\0' || line[start] == '#')
+		{
+			continue;
+		}
+
+		if (*numJobs == capacity)
+		{
+			capacity *= 2;
+			*jobs = (BatchJob*)realloc(*jobs, sizeof(BatchJob) * capacity);
+		}
+
+		if (parseJob(line, numIterations, kernel, &(*jobs)[*numJobs]))
+		{
+			fprintf(stderr, "Invalid job on line %d of '%s'.\n", lineNumber,
+					fileName);
+
+			fclose(jobFile);
+			free(*jobs);
+			*jobs = NULL;
+
+			return BATCH_FILE_FAIL;
+		}
+
+		(*numJobs)++;
+	}
+
+	fclose(jobFile);
+
+	return GET_ARGS_SUCCEED;
+}
+
+/**
+@fn batchWorker
+@brief Computes pieces of a batch until none are left. The thread that
+finishes the last piece of a job writes its image.
+@param data A void pointer to be cast into a BatchData struct.
+*/
+int batchWorker (void *data)
+{
+	BatchData *d = (BatchData*)data;
+	int i;
+
+	while ((i = SDL_AtomicAdd(&d->nextPiece, 1)) < d->numPieces)
+	{
+		BatchPiece *piece = &(d->pieces[i]);
+		BatchJob *job = &(d->jobs[piece->job]);
+		long windowWidth = job->params.windowWidth;
+		long windowHeight = job->params.windowHeight;
+
+		/* The first thread to reach a job allocates its color map, so only the
+		   jobs in progress hold memory. */
+		SDL_AtomicLock(&job->lock);
+
+		if (job->colorMap == NULL)
+		{
+			job->colorMap = newColorMap(windowWidth, windowHeight);
+		}
+
+		SDL_Color **colorMap = job->colorMap;
+
+		SDL_AtomicUnlock(&job->lock);
+
+		fillJuliaRegion(&job->params, colorMap, NULL, piece->x0, 0, piece->x1,
+						windowHeight);
+
+		/* Write and free the image once its last piece is done. */
+		if (SDL_AtomicAdd(&job->piecesLeft, -1) == 1)
+		{
+			if (!writeColorMap(job->outputFile, colorMap, windowWidth,
+							   windowHeight))
+			{
+				fprintf(stderr, "Could not write '%s'.\n", job->outputFile);
+
+				job->failed = true;
+			}
+
+			freeColorMap(colorMap, windowWidth, windowHeight);
+			job->colorMap = NULL;
+		}
+	}
+
+	return 0;
+}
+
+/**
+@fn runBatch
+@brief Renders every job of a job file and writes each image to disk.
+@details runBatch() is called as Project04_01 --batch jobFile numberOfThreads.
+Each non-empty line of the job file not starting with '#' describes one image:
+	windowWidth windowHeight planeWidth planeHeight centerX centerY a b outputFile
+optionally followed by options such as --map=NAME (see getOptions()).
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if every image was written.
+*/
+int runBatch (int argc, char *argv[], int numIterations)
+{
+	/*** Read in command line arguments. ***/
+	if (argc < 4)
+	{
+		fprintf(stderr, "Usage: %s --batch jobFile numberOfThreads\n", argv[0]);
+
+		return INSUFFICIENT_ARGS_FAIL;
+	}
+
+	char *endptr = NULL;
+	long numberOfThreads = strtol(argv[3], &endptr, 10);
+
+	if (endptr == argv[3] || *endptr != '\0')
+	{
+		fprintf(stderr, "Non-number arg given. All args must be numbers.\n");
+
+		return ARG_NOT_A_NUMBER_FAIL;
+	}
+	if (numberOfThreads <= 0)
+	{
+		fprintf(stderr, "Number of threads must be greater than 0.\n");
+
+		return ARG_BELOW_ONE_FAIL;
+	}
+
+	BatchJob *jobs = NULL;
+	int numJobs = 0;
+	int result = readJobFile(argv[2], numIterations, &jobs, &numJobs);
+
+	if (result)
+	{
+		return result;
+	}
+
+	/*** Split the jobs into pieces. Small jobs stay whole so that threads
+		 compute different jobs side by side, large jobs are split by columns
+		 so that every thread can help with them. ***/
+	BatchData data;
+	int capacity = numJobs;
+
+	data.jobs = jobs;
+	data.pieces = (BatchPiece*)malloc(sizeof(BatchPiece) * (capacity + 1));
+	data.numPieces = 0;
+	SDL_AtomicSet(&data.nextPiece, 0);
+
+	for (int job = 0; job < numJobs; job++)
+	{
+		long windowWidth = jobs[job].params.windowWidth;
+		long pixels = windowWidth * jobs[job].params.windowHeight;
+		long numPieces = pixels / BATCH_PIECE_PIXELS;
+
+		if (numPieces < 1)
+		{
+			numPieces = 1;
+		}
+		if (numPieces > windowWidth)
+		{
+			numPieces = windowWidth;
+		}
+
+		if (data.numPieces + numPieces > capacity)
+		{
+			capacity = 2 * capacity + (int)numPieces;
+			data.pieces = (BatchPiece*)realloc(data.pieces, 
+											   sizeof(BatchPiece) * capacity);
+		}
+
+		for (long piece = 0; piece < numPieces; piece++)
+		{
+			data.pieces[data.numPieces].job = job;
+			data.pieces[data.numPieces].x0 = piece * windowWidth / numPieces;
+			data.pieces[data.numPieces].x1 = (piece + 1) * windowWidth / numPieces;
+			data.numPieces++;
+		}
+
+		SDL_AtomicSet(&jobs[job].piecesLeft, (int)numPieces);
+	}
+
+	/*** Run the batch. ***/
+	SDL_Thread *threadList[numberOfThreads];
+
+	Uint32 startTime = SDL_GetTicks();
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		threadList[threadID] = SDL_CreateThread(batchWorker, "Batch Thread",
+												(void*)&data);
+	}
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		SDL_WaitThread(threadList[threadID], NULL);
+	}
+
+	Uint32 endTime = SDL_GetTicks();
+
+	/*** Report how the batch went. ***/
+	int failures = 0;
+
+	for (int job = 0; job < numJobs; job++)
+	{
+		if (jobs[job].failed)
+		{
+			failures++;
+		}
+	}
+
+	printf("Rendered %d jobs (%d pieces), %d failed.\n", numJobs, 
+		   data.numPieces, failures);
+	printf("Processing time: %dms\n", endTime - startTime);
+
+	free(data.pieces);
+	free(jobs);
+
+	return failures ? BATCH_JOB_FAIL : GET_ARGS_SUCCEED;
+}
@@ -0,0 +1,129 @@
+/**
+@file Batch.h
+@author Rob Thomas
+@brief Contains functions for rendering many Julia set images, described by a
+job file, in a single process.
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "HelperFunctions.h"
+
+
+/**
+@def BATCH_FILE_FAIL
+@brief Error code indicating that the job file could not be read or contained
+an invalid job.
+*/
+#define BATCH_FILE_FAIL 6
+
+/**
+@def BATCH_JOB_FAIL
+@brief Error code indicating that the output of at least one job could not be
+written.
+*/
+#define BATCH_JOB_FAIL 7
+
+/**
+@def BATCH_PIECE_PIXELS
+@brief The approximate number of pixels in one unit of work. Jobs smaller than
+this are computed whole by a single thread, larger jobs are split into pieces
+of about this size that are spread over all threads.
+*/
+#define BATCH_PIECE_PIXELS 65536
+
+/**
+@def MAX_JOB_LINE
+@brief The maximum length of one line of a job file.
+*/
+#define MAX_JOB_LINE 1024
+
+/**
+@def MAX_JOB_TOKENS
+@brief The maximum number of whitespace separated fields in one job.
+*/
+#define MAX_JOB_TOKENS 16
+
+
+/**
+@typedef BatchJob
+@brief The BatchJob struct holds one image of a batch and its progress. The
+color map is only allocated while the job is being computed.
+*/
+typedef struct BatchJob
+{
+	JuliaParams params;
+	char outputFile[MAX_JOB_LINE];
+	SDL_Color **colorMap;
+	SDL_SpinLock lock;
+	SDL_atomic_t piecesLeft;
+	bool failed;
+} BatchJob;
+
+/**
+@typedef BatchPiece
+@brief The BatchPiece struct describes one unit of work: a range of columns of
+one job.
+*/
+typedef struct BatchPiece
+{
+	int job;
+	long x0, x1;
+} BatchPiece;
+
+/**
+@typedef BatchData
+@brief The BatchData struct is shared by all threads of a batch. Threads claim
+pieces in order through nextPiece.
+*/
+typedef struct BatchData
+{
+	BatchJob *jobs;
+	BatchPiece *pieces;
+	int numPieces;
+	SDL_atomic_t nextPiece;
+} BatchData;
+
+
+/**
+@fn runBatch
+@brief Renders every job of a job file and writes each image to disk.
+@details runBatch() is called as Project04_01 --batch jobFile numberOfThreads.
+Each non-empty line of the job file not starting with '#' describes one image:
+	windowWidth windowHeight planeWidth planeHeight centerX centerY a b outputFile
+optionally followed by options such as --map=NAME (see getOptions()).
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if every image was written.
+*/
+int runBatch (int argc, char *argv[], int numIterations);
+
+/**
+@fn readJobFile
+@brief Reads the jobs described by a job file. Jobs without --kernel use the
+kernel in AUTOTUNE_PROFILE_FILE (see Autotune.h), or the scalar one if there
+is no profile.
+@param fileName The name of the job file.
+@param numIterations The number of iterations to apply to each point.
+@param jobs Pointer to where the dynamically allocated list of jobs will be 
+stored.
+@param numJobs Pointer to where the number of jobs will be stored.
+@return An error code. 0 if every job was read.
+*/
+int readJobFile (const char *fileName, int numIterations, BatchJob **jobs,
+				 int *numJobs);
+
+/**
+@fn batchWorker
+@brief Computes pieces of a batch until none are left. The thread that
+finishes the last piece of a job writes its image.
+@param data A void pointer to be cast into a BatchData struct.
+*/
+int batchWorker (void *data);
+
+#endif /* BATCH_H */
@@ -0,0 +1,343 @@
+/**
+@file Checkpoint.c
+@author Rob Thomas
+@brief Contains functions for saving the finished parts of a render to disk
+as it goes, and for resuming an interrupted render from them.
+*/
+
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "HelperFunctions.h"
+#include "TileQueue.h"
+
+#include "Checkpoint.h"
+
+
+/**
+@fn checkpointHeader
+@brief Builds the header that a checkpoint of an image starts with.
+@param params The image being rendered.
+@param header Where the CHECKPOINT_HEADER_SIZE bytes of the header are stored.
+*/
+static void checkpointHeader (const JuliaParams *params, Uint8 *header)
+{
+	memset(header, 0, CHECKPOINT_HEADER_SIZE);
+	memcpy(header, CHECKPOINT_MAGIC, 4);
+	putU32(header + 4, 1);
+	putU32(header + 8, (Uint32)params->windowWidth);
+	putU32(header + 12, (Uint32)params->windowHeight);
+	putU32(header + 16, (Uint32)params->numIterations);
+	putU32(header + 20, (Uint32)params->map);
+	putU32(header + 24, (Uint32)params->coloring);
+	putU32(header + 28, (Uint32)params->renderer);
+	putDouble(header + 32, params->centerX);
+	putDouble(header + 40, params->centerY);
+	putDouble(header + 48, params->planeWidth);
+	putDouble(header + 56, params->planeHeight);
+	putDouble(header + 64, creal(params->C));
+	putDouble(header + 72, cimag(params->C));
+}
+
+/**
+@fn recordChecksum
+@brief Computes the FNV-1a hash of a record: its columns and their colors.
+@param x0 The first column of the record.
+@param x1 One past the last column of the record.
+@param colors The colors of the columns.
+@param numColors The number of colors.
+@return The checksum.
+*/
+static Uint32 recordChecksum (long x0, long x1, const SDL_Color *colors,
+							  long numColors)
+{
+	Uint8 columns[8];
+	const Uint8 *bytes = (const Uint8*)colors;
+	Uint32 hash = 2166136261u;
+
+	putU32(columns, (Uint32)x0);
+	putU32(columns + 4, (Uint32)x1);
+
+	for (int i = 0; i < 8; i++)
+	{
+		hash = (hash ^ columns[i]) * 16777619u;
+	}
+
+	for (long i = 0; i < numColors * (long)sizeof(SDL_Color); i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+@fn restoreCheckpoint
+@brief Reads the records of a checkpoint file back into the color map.
+@param file The checkpoint file, just past its header.
+@param params The image being rendered.
+@param colorMap The color map of the image.
+@param finishedColumns The flags of the columns that were restored.
+@return The size (in bytes) of the part of the file that holds whole, valid
+records. New records are appended from there.
+*/
+static long restoreCheckpoint (FILE *file, const JuliaParams *params,
+							   SDL_Color **colorMap, bool *finishedColumns)
+{
+	long validSize = CHECKPOINT_HEADER_SIZE;
+	long restored = 0;
+	Uint8 record[CHECKPOINT_RECORD_SIZE];
+
+	while (fread(record, 1, sizeof(record), file) == sizeof(record))
+	{
+		long x0 = getU32(record);
+		long x1 = getU32(record + 4);
+
+		if (x0 >= x1 || x1 > params->windowWidth)
+		{
+			break;
+		}
+
+		/* The columns of the color map are stored one after the other. */
+		long numColors = (x1 - x0) * params->windowHeight;
+
+		if (fread(colorMap[x0], sizeof(SDL_Color), numColors, file) !=
+			(size_t)numColors ||
+			recordChecksum(x0, x1, colorMap[x0], numColors) !=
+			getU32(record + 8))
+		{
+			break;
+		}
+
+		for (long x = x0; x < x1; x++)
+		{
+			restored += !finishedColumns[x];
+			finishedColumns[x] = true;
+		}
+
+		validSize = ftell(file);
+	}
+
+	printf("Resumed %ld of %ld columns.\n", restored, params->windowWidth);
+
+	return validSize;
+}
+
+/**
+@fn openCheckpoint
+@brief Opens a checkpoint file and starts the thread that writes it.
+@param checkpoint Pointer to the checkpoint to be opened.
+@param fileName The name of the checkpoint file.
+@param params The image being rendered.
+@param colorMap The color map of the image.
+@param finishedColumns An array of windowWidth flags. If resume is true, the
+columns restored from the file are copied to colorMap and flagged.
+@param numChunks The most chunks the workers will push.
+@param resume Whether to continue the render saved in the file. If false, or
+if there is no such file, a new file is started.
+@param interval The number of seconds between two saves.
+@return An error code. 0 if the checkpoint was opened.
+*/
+int openCheckpoint (Checkpoint *checkpoint, const char *fileName,
+					const JuliaParams *params, SDL_Color **colorMap,
+					bool *finishedColumns, long numChunks, bool resume,
+					int interval)
+{
+	Uint8 header[CHECKPOINT_HEADER_SIZE];
+
+	checkpointHeader(params, header);
+
+	checkpoint->file = resume ? fopen(fileName, "r+b") : NULL;
+
+	/*** Restore the finished columns of an earlier render. ***/
+	if (checkpoint->file != NULL)
+	{
+		Uint8 saved[CHECKPOINT_HEADER_SIZE];
+
+		if (fread(saved, 1, sizeof(saved), checkpoint->file) != sizeof(saved) ||
+			memcmp(saved, header, sizeof(header)) != 0)
+		{
+			fprintf(stderr, "'%s' is not a checkpoint of this image.\n",
+					fileName);
+			fclose(checkpoint->file);
+
+			return CHECKPOINT_READ_FAIL;
+		}
+
+		long validSize = restoreCheckpoint(checkpoint->file, params, colorMap,
+										   finishedColumns);
+
+		/* Overwrite whatever was cut off when the last save was
+		   interrupted. */
+		if (fseek(checkpoint->file, validSize, SEEK_SET) != 0)
+		{
+			fprintf(stderr, "Could not write '%s'.\n", fileName);
+			fclose(checkpoint->file);
+
+			return CHECKPOINT_WRITE_FAIL;
+		}
+	}
+	else
+	{
+		if (resume)
+		{
+			printf("No checkpoint found in '%s', starting over.\n", fileName);
+		}
+
+		checkpoint->file = fopen(fileName, "wb");
+
+		if (checkpoint->file == NULL ||
+			fwrite(header, 1, sizeof(header), checkpoint->file) !=
+			sizeof(header) || fflush(checkpoint->file) != 0)
+		{
+			fprintf(stderr, "Could not write '%s'.\n", fileName);
+
+			if (checkpoint->file != NULL)
+			{
+				fclose(checkpoint->file);
+			}
+
+			return CHECKPOINT_WRITE_FAIL;
+		}
+	}
+
+	/*** Start the writer thread. ***/
+	checkpoint->tiles = newTileQueue(numChunks);
+	checkpoint->colorMap = colorMap;
+	checkpoint->windowHeight = params->windowHeight;
+	checkpoint->interval = (Uint32)interval * 1000;
+	checkpoint->lock = SDL_CreateMutex();
+	checkpoint->wake = SDL_CreateCond();
+	checkpoint->stopping = false;
+	checkpoint->failed = false;
+	checkpoint->writer = NULL;
+
+	if (checkpoint->tiles != NULL && checkpoint->lock != NULL &&
+		checkpoint->wake != NULL)
+	{
+		checkpoint->writer = SDL_CreateThread(checkpointWriter,
+											  "Checkpoint Thread",
+											  (void*)checkpoint);
+	}
+
+	if (checkpoint->writer == NULL)
+	{
+		fprintf(stderr, "Could not start saving '%s'.\n", fileName);
+
+		if (checkpoint->tiles != NULL)
+		{
+			freeTileQueue(checkpoint->tiles);
+		}
+		SDL_DestroyMutex(checkpoint->lock);
+		SDL_DestroyCond(checkpoint->wake);
+		fclose(checkpoint->file);
+
+		return CHECKPOINT_WRITE_FAIL;
+	}
+
+	return GET_ARGS_SUCCEED;
+}
+
+/**
+@fn saveFinishedTiles
+@brief Appends every chunk that is waiting in the queue to the checkpoint
+file and flushes it.
+@param checkpoint The checkpoint being written.
+*/
+static void saveFinishedTiles (Checkpoint *checkpoint)
+{
+	Tile tile;
+	bool saved = false;
+
+	while (popTile(checkpoint->tiles, &tile))
+	{
+		Uint8 record[CHECKPOINT_RECORD_SIZE];
+		const SDL_Color *colors = checkpoint->colorMap[tile.x0];
+		long numColors = (tile.x1 - tile.x0) * checkpoint->windowHeight;
+
+		putU32(record, (Uint32)tile.x0);
+		putU32(record + 4, (Uint32)tile.x1);
+		putU32(record + 8, recordChecksum(tile.x0, tile.x1, colors,
+										  numColors));
+
+		if (fwrite(record, 1, sizeof(record), checkpoint->file) !=
+			sizeof(record) ||
+			fwrite(colors, sizeof(SDL_Color), numColors, checkpoint->file) !=
+			(size_t)numColors)
+		{
+			checkpoint->failed = true;
+		}
+
+		saved = true;
+	}
+
+	if (saved && fflush(checkpoint->file) != 0)
+	{
+		checkpoint->failed = true;
+	}
+}
+
+/**
+@fn checkpointWriter
+@brief Appends the chunks finished since the last save to the checkpoint file
+every interval, until the checkpoint is closed.
+@param data A void pointer to be cast into a Checkpoint struct.
+*/
+int checkpointWriter (void *data)
+{
+	Checkpoint *checkpoint = (Checkpoint*)data;
+
+	SDL_LockMutex(checkpoint->lock);
+
+	while (!checkpoint->stopping)
+	{
+		SDL_CondWaitTimeout(checkpoint->wake, checkpoint->lock,
+							checkpoint->interval);
+
+		/* Write without holding the lock; only this thread touches the
+		   file. */
+		SDL_UnlockMutex(checkpoint->lock);
+		saveFinishedTiles(checkpoint);
+		SDL_LockMutex(checkpoint->lock);
+	}
+
+	SDL_UnlockMutex(checkpoint->lock);
+
+	/* Save the chunks that finished while the last save was written. */
+	saveFinishedTiles(checkpoint);
+
+	return 0;
+}
+
+/**
+@fn closeCheckpoint
+@brief Saves the chunks that are still waiting, stops the writer thread and
+closes the checkpoint file. No thread may push chunks to the checkpoint
+anymore.
+@param checkpoint Pointer to the checkpoint to be closed.
+@return true if every chunk was saved, false otherwise.
+*/
+bool closeCheckpoint (Checkpoint *checkpoint)
+{
+	SDL_LockMutex(checkpoint->lock);
+	checkpoint->stopping = true;
+	SDL_CondSignal(checkpoint->wake);
+	SDL_UnlockMutex(checkpoint->lock);
+
+	SDL_WaitThread(checkpoint->writer, NULL);
+
+	bool closed = (fclose(checkpoint->file) == 0);
+	bool saved = !checkpoint->failed && closed;
+
+	freeTileQueue(checkpoint->tiles);
+	SDL_DestroyMutex(checkpoint->lock);
+	SDL_DestroyCond(checkpoint->wake);
+
+	return saved;
+}
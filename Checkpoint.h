@@ -0,0 +1,120 @@
+/**
+@file Checkpoint.h
+@author Rob Thomas
+@brief Contains functions for saving the finished parts of a render to disk
+as it goes, and for resuming an interrupted render from them.
+@details A checkpoint file starts with a header of CHECKPOINT_HEADER_SIZE
+bytes that describes the image, followed by one record per finished chunk of
+columns in the order they were saved. A record is the first column, one past
+the last column and a checksum of the record (4 bytes each, little-endian),
+followed by the colors of its columns, column by column. Records are only
+ever appended, so an interrupted save can at worst leave one damaged record
+at the end, which fails its checksum and is computed again.
+*/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "HelperFunctions.h"
+#include "TileQueue.h"
+
+
+/**
+@def CHECKPOINT_WRITE_FAIL
+@brief Error code indicating that a checkpoint file could not be written.
+*/
+#define CHECKPOINT_WRITE_FAIL 12
+
+/**
+@def CHECKPOINT_READ_FAIL
+@brief Error code indicating that a checkpoint file could not be read or does
+not belong to the image being rendered.
+*/
+#define CHECKPOINT_READ_FAIL 13
+
+/**
+@def CHECKPOINT_MAGIC
+@brief The four bytes every checkpoint file starts with.
+*/
+#define CHECKPOINT_MAGIC "JCK1"
+
+/**
+@def CHECKPOINT_HEADER_SIZE
+@brief The size (in bytes) of the header of a checkpoint file.
+*/
+#define CHECKPOINT_HEADER_SIZE 80
+
+/**
+@def CHECKPOINT_RECORD_SIZE
+@brief The size (in bytes) of the part of a record that comes before its
+colors.
+*/
+#define CHECKPOINT_RECORD_SIZE 12
+
+
+/**
+@typedef Checkpoint
+@brief The Checkpoint struct describes a checkpoint file that is being
+written. Worker threads push finished chunks to tiles without waiting, and a
+writer thread wakes up every interval milliseconds (or when stopping is set)
+to append them to file.
+*/
+typedef struct Checkpoint
+{
+	FILE *file;
+	TileQueue *tiles;
+	SDL_Color **colorMap;
+	long windowHeight;
+	Uint32 interval;
+	SDL_mutex *lock;
+	SDL_cond *wake;
+	bool stopping;
+	bool failed;
+	SDL_Thread *writer;
+} Checkpoint;
+
+
+/**
+@fn openCheckpoint
+@brief Opens a checkpoint file and starts the thread that writes it.
+@param checkpoint Pointer to the checkpoint to be opened.
+@param fileName The name of the checkpoint file.
+@param params The image being rendered.
+@param colorMap The color map of the image.
+@param finishedColumns An array of windowWidth flags. If resume is true, the
+columns restored from the file are copied to colorMap and flagged.
+@param numChunks The most chunks the workers will push.
+@param resume Whether to continue the render saved in the file. If false, or
+if there is no such file, a new file is started.
+@param interval The number of seconds between two saves.
+@return An error code. 0 if the checkpoint was opened.
+*/
+int openCheckpoint (Checkpoint *checkpoint, const char *fileName,
+					const JuliaParams *params, SDL_Color **colorMap,
+					bool *finishedColumns, long numChunks, bool resume,
+					int interval);
+
+/**
+@fn checkpointWriter
+@brief Appends the chunks finished since the last save to the checkpoint file
+every interval, until the checkpoint is closed.
+@param data A void pointer to be cast into a Checkpoint struct.
+*/
+int checkpointWriter (void *data);
+
+/**
+@fn closeCheckpoint
+@brief Saves the chunks that are still waiting, stops the writer thread and
+closes the checkpoint file. No thread may push chunks to the checkpoint
+anymore.
+@param checkpoint Pointer to the checkpoint to be closed.
+@return true if every chunk was saved, false otherwise.
+*/
+bool closeCheckpoint (Checkpoint *checkpoint);
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,710 @@
+/**
+@file Deadline.c
+@author Rob Thomas
+@brief Contains functions for showing a Julia set in the window within a fixed
+time per frame, by lowering the quality of the image where needed and
+refining it in later frames.
+*/
+
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "Drawing.h"
+#include "HelperFunctions.h"
+#include "JuliaSet.h"
+#include "TileQueue.h"
+
+#include "Deadline.h"
+
+
+/**
+@typedef DeadlineLevel
+@brief The DeadlineLevel struct describes one quality level: one sample is
+computed for every block of scale x scale pixels, with the number of
+iterations divided by divisor.
+*/
+typedef struct DeadlineLevel
+{
+	long scale;
+	int divisor;
+} DeadlineLevel;
+
+static const DeadlineLevel deadlineLevels[DEADLINE_LEVELS] =
+{
+	{ 1, 1 },
+	{ 2, 1 },
+	{ 4, 2 },
+	{ 8, 4 }
+};
+
+/**
+@typedef TileDistance
+@brief The TileDistance struct pairs a tile with its distance from the center
+of the window, for sorting the tiles from the center out.
+*/
+typedef struct TileDistance
+{
+	double distance;
+	long tile;
+} TileDistance;
+
+/**
+@fn compareDistances
+@brief Orders two TileDistance structs by distance, for qsort().
+*/
+static int compareDistances (const void *a, const void *b)
+{
+	double d = ((const TileDistance*)a)->distance -
+			   ((const TileDistance*)b)->distance;
+
+	return (d > 0.0) - (d < 0.0);
+}
+
+/**
+@fn newDeadlineRender
+@brief Dynamically allocates the tiles of a window for rendering with a frame
+budget.
+@param windowWidth The width (in pixels) of the window.
+@param windowHeight The height (in pixels) of the window.
+@return The new DeadlineRender, or NULL if it could not be allocated.
+*/
+DeadlineRender * newDeadlineRender (long windowWidth, long windowHeight)
+{
+	long tilesAcross = (windowWidth + DEADLINE_TILE_SIZE - 1) /
+					   DEADLINE_TILE_SIZE;
+	long tilesDown = (windowHeight + DEADLINE_TILE_SIZE - 1) /
+					 DEADLINE_TILE_SIZE;
+	DeadlineRender *render = (DeadlineRender*)calloc(1, sizeof(DeadlineRender));
+
+	if (render == NULL)
+	{
+		return NULL;
+	}
+
+	render->numTiles = tilesAcross * tilesDown;
+	render->tiles = (DeadlineTile*)malloc(render->numTiles *
+										  sizeof(DeadlineTile));
+	render->order = (long*)malloc(render->numTiles * sizeof(long));
+	render->work = (DeadlineWork*)malloc(render->numTiles *
+										 sizeof(DeadlineWork));
+
+	TileDistance *distances = (TileDistance*)malloc(render->numTiles *
+													sizeof(TileDistance));
+
+	if (render->tiles == NULL || render->order == NULL ||
+		render->work == NULL || distances == NULL)
+	{
+		free(distances);
+		freeDeadlineRender(render);
+
+		return NULL;
+	}
+
+	/*** Cut the window into tiles, and order them from the center out. ***/
+	for (long i = 0; i < render->numTiles; i++)
+	{
+		Tile *rect = &render->tiles[i].rect;
+
+		rect->x0 = (i % tilesAcross) * DEADLINE_TILE_SIZE;
+		rect->y0 = (i / tilesAcross) * DEADLINE_TILE_SIZE;
+		rect->x1 = (rect->x0 + DEADLINE_TILE_SIZE < windowWidth) ?
+				   rect->x0 + DEADLINE_TILE_SIZE : windowWidth;
+		rect->y1 = (rect->y0 + DEADLINE_TILE_SIZE < windowHeight) ?
+				   rect->y0 + DEADLINE_TILE_SIZE : windowHeight;
+
+		double dx = (rect->x0 + rect->x1 - windowWidth) / 2.0;
+		double dy = (rect->y0 + rect->y1 - windowHeight) / 2.0;
+
+		distances[i].distance = dx * dx + dy * dy;
+		distances[i].tile = i;
+	}
+
+	qsort(distances, render->numTiles, sizeof(TileDistance),
+		  compareDistances);
+
+	for (long i = 0; i < render->numTiles; i++)
+	{
+		render->order[i] = distances[i].tile;
+	}
+
+	free(distances);
+
+	/* Neither is measured yet. */
+	render->averageCost = 0.0;
+	render->uploadCost = 0.0;
+	render->overhead = -1.0;
+
+	return render;
+}
+
+/**
+@fn levelSamples
+@brief Gives the number of samples computed for a tile at a level.
+@param tile The tile.
+@param level The level.
+@return The number of samples.
+*/
+static long levelSamples (const DeadlineTile *tile, int level)
+{
+	long scale = deadlineLevels[level].scale;
+
+	return ((tile->rect.x1 - tile->rect.x0 + scale - 1) / scale) *
+		   ((tile->rect.y1 - tile->rect.y0 + scale - 1) / scale);
+}
+
+/**
+@fn levelIterations
+@brief Gives the number of iterations done for a sample at a level.
+@param params The view being shown.
+@param level The level.
+@return The number of iterations, at least 1.
+*/
+static int levelIterations (const JuliaParams *params, int level)
+{
+	int iterations = params->numIterations / deadlineLevels[level].divisor;
+
+	return (iterations > 0) ? iterations : 1;
+}
+
+/**
+@fn predictCost
+@brief Predicts how long computing a tile at a level takes on one thread.
+@param render The tiles of the window.
+@param tile The tile.
+@param level The level.
+@return The predicted time (in milliseconds).
+*/
+static double predictCost (const DeadlineRender *render,
+						   const DeadlineTile *tile, int level)
+{
+	double cost = tile->cost;
+
+	if (cost <= 0.0)
+	{
+		cost = (render->averageCost > 0.0) ? render->averageCost :
+			   DEADLINE_INITIAL_COST;
+	}
+
+	return cost * levelSamples(tile, level) *
+		   levelIterations(&render->params, level);
+}
+
+/**
+@fn uploadTime
+@brief Predicts how long uploading a tile to the texture takes.
+@param render The tiles of the window.
+@param tile The tile.
+@return The predicted time (in milliseconds).
+*/
+static double uploadTime (const DeadlineRender *render,
+						  const DeadlineTile *tile)
+{
+	return render->uploadCost * (tile->rect.x1 - tile->rect.x0) *
+		   (tile->rect.y1 - tile->rect.y0);
+}
+
+/**
+@fn workCost
+@brief Predicts how much of the capacity of a frame computing a tile at a
+level uses. Tiles are uploaded by one thread while the others wait, so the
+upload counts once for every thread.
+@param render The tiles of the window.
+@param tile The tile.
+@param level The level.
+@return The predicted time (in milliseconds of one thread).
+*/
+static double workCost (const DeadlineRender *render,
+						const DeadlineTile *tile, int level)
+{
+	return predictCost(render, tile, level) +
+		   uploadTime(render, tile) * render->numWorkers;
+}
+
+/**
+@fn addWork
+@brief Adds the computing of a tile at a level to the work of the frame.
+@param render The tiles of the window.
+@param tile The index of the tile.
+@param level The level.
+*/
+static void addWork (DeadlineRender *render, long tile, int level)
+{
+	DeadlineWork *work = &render->work[render->numWork++];
+
+	work->tile = tile;
+	work->level = level;
+	work->predicted = predictCost(render, &render->tiles[tile], level);
+	work->time = -1.0;
+}
+
+/**
+@fn planFrame
+@brief Chooses the work of the next frame.
+@details Tiles that are not shown yet come first: all of them at the finest
+level whose predicted cost fits in capacity or, if none does, as many as fit
+at the coarsest level, from the center out. The rest of capacity is spent
+moving shown tiles one level up, coarsest tiles first and from the center
+out. If no refinement fits, one is planned anyway, so the image keeps
+getting better even if one tile costs more than a whole frame.
+@param render The tiles of the window.
+@param capacity The time (in milliseconds of one thread, see workCost()) the
+frame has for computing and uploading.
+@return The predicted time (in milliseconds) of uploading the planned tiles.
+*/
+static double planFrame (DeadlineRender *render, double capacity)
+{
+	double used = 0.0;
+	double upload = 0.0;
+	int level;
+
+	render->numWork = 0;
+
+	/*** Tiles that are not shown yet. ***/
+	for (level = 0; level < DEADLINE_LEVELS - 1; level++)
+	{
+		double cost = 0.0;
+
+		for (long i = 0; i < render->numTiles; i++)
+		{
+			if (render->tiles[i].level == DEADLINE_LEVELS)
+			{
+				cost += workCost(render, &render->tiles[i], level);
+			}
+		}
+
+		if (cost <= capacity)
+		{
+			break;
+		}
+	}
+
+	for (long i = 0; i < render->numTiles; i++)
+	{
+		DeadlineTile *tile = &render->tiles[render->order[i]];
+
+		if (tile->level != DEADLINE_LEVELS)
+		{
+			continue;
+		}
+
+		double cost = workCost(render, tile, level);
+
+		/* Only the coarsest level can overflow; the rest of the tiles are
+		   left to the next frames. */
+		if (used + cost > capacity && render->numWork > 0)
+		{
+			return upload;
+		}
+
+		addWork(render, render->order[i], level);
+		used += cost;
+		upload += uploadTime(render, tile);
+	}
+
+	/*** Shown tiles that can be refined. ***/
+	long fallback = -1;
+
+	for (int from = DEADLINE_LEVELS - 1; from > 0; from--)
+	{
+		for (long i = 0; i < render->numTiles; i++)
+		{
+			DeadlineTile *tile = &render->tiles[render->order[i]];
+
+			if (tile->level != from)
+			{
+				continue;
+			}
+
+			double cost = workCost(render, tile, from - 1);
+
+			if (used + cost <= capacity)
+			{
+				addWork(render, render->order[i], from - 1);
+				used += cost;
+				upload += uploadTime(render, tile);
+			}
+			else if (fallback < 0)
+			{
+				fallback = render->order[i];
+			}
+		}
+	}
+
+	/* If nothing fits, refine the coarsest tile closest to the center anyway;
+	   it gets measured again, which also undoes a measurement that was too
+	   high because its thread was interrupted. */
+	if (render->numWork == 0 && fallback >= 0)
+	{
+		addWork(render, fallback, render->tiles[fallback].level - 1);
+		upload += uploadTime(render, &render->tiles[fallback]);
+	}
+
+	return upload;
+}
+
+/**
+@fn computeWork
+@brief Computes one tile of the window at one level. Each sample colors the
+block of pixels it stands for.
+@param render The tiles of the window.
+@param work The tile and level to compute.
+@param re Room for the real parts of the samples of one tile.
+@param im Room for the imaginary parts of the samples of one tile.
+@param counts Room for the stages of the samples of one tile.
+*/
+static void computeWork (DeadlineRender *render, const DeadlineWork *work,
+						 double *re, double *im, Sint32 *counts)
+{
+	const Tile *rect = &render->tiles[work->tile].rect;
+	long scale = deadlineLevels[work->level].scale;
+	JuliaParams params = render->params;
+	SDL_Color **colorMap = render->colorMap;
+
+	params.numIterations = levelIterations(&render->params, work->level);
+
+	if (scale == 1)
+	{
+		fillJuliaRegion(&params, colorMap, NULL, rect->x0, rect->y0, rect->x1,
+						rect->y1);
+
+		return;
+	}
+
+	/*** Sample the middle of each block... ***/
+	long numSamples = 0;
+
+	for (long x = rect->x0; x < rect->x1; x += scale)
+	{
+		long sampleX = (x + scale / 2 < rect->x1) ? x + scale / 2 :
+					   rect->x1 - 1;
+
+		for (long y = rect->y0; y < rect->y1; y += scale)
+		{
+			long sampleY = (y + scale / 2 < rect->y1) ? y + scale / 2 :
+						   rect->y1 - 1;
+
+			re[numSamples] = XTransform(sampleX, params.centerX,
+										params.planeWidth, params.windowWidth);
+			im[numSamples] = YTransform(sampleY, params.centerY,
+										params.planeHeight,
+										params.windowHeight);
+			numSamples++;
+		}
+	}
+
+	fillJuliaPoints(&params, re, im, numSamples, counts);
+
+	/*** ...and color the whole block with it. ***/
+	numSamples = 0;
+
+	for (long x = rect->x0; x < rect->x1; x += scale)
+	{
+		long blockX1 = (x + scale < rect->x1) ? x + scale : rect->x1;
+
+		for (long y = rect->y0; y < rect->y1; y += scale)
+		{
+			long blockY1 = (y + scale < rect->y1) ? y + scale : rect->y1;
+			Sint32 stage = counts[numSamples++];
+			SDL_Color color = (stage == JULIA_IN_SET) ? colorInSet() :
+							  colorOutOfSet(stage);
+
+			for (long blockX = x; blockX < blockX1; blockX++)
+			{
+				for (long blockY = y; blockY < blockY1; blockY++)
+				{
+					colorMap[blockX][blockY] = color;
+				}
+			}
+		}
+	}
+}
+
+/**
+@fn partialDeadline
+@brief Computes entries of the work of the current frame until none are left.
+Entries that would not be finished before the frame runs out of time are
+skipped.
+@param data A void pointer to be cast into a DeadlineRender struct.
+*/
+int partialDeadline (void *data)
+{
+	DeadlineRender *render = (DeadlineRender*)data;
+	double re[DEADLINE_TILE_SIZE * DEADLINE_TILE_SIZE];
+	double im[DEADLINE_TILE_SIZE * DEADLINE_TILE_SIZE];
+	Sint32 counts[DEADLINE_TILE_SIZE * DEADLINE_TILE_SIZE];
+	double frequency = SDL_GetPerformanceFrequency() / 1000.0;
+
+	while (true)
+	{
+		long entry = SDL_AtomicAdd(&render->nextWork, 1);
+
+		if (entry >= render->numWork)
+		{
+			break;
+		}
+
+		DeadlineWork *work = &render->work[entry];
+		Uint64 startTime = SDL_GetPerformanceCounter();
+
+		/* The first entry is always computed, so that every frame gets
+		   somewhere even if it has no time at all. */
+		if (entry > 0 && startTime + (Uint64)(work->predicted * frequency) >
+			render->stopTime)
+		{
+			continue;
+		}
+
+		computeWork(render, work, re, im, counts);
+
+		work->time = (SDL_GetPerformanceCounter() - startTime) / frequency;
+	}
+
+	return 0;
+}
+
+/**
+@fn finishFrame
+@brief Uploads the tiles that were computed in a frame to the texture, and
+records the new level and measured cost of each of them, the average cost
+of the frame and the time uploading took per pixel.
+@param render The tiles of the window.
+@param texture The texture that shows the color map.
+*/
+static void finishFrame (DeadlineRender *render, SDL_Texture *texture)
+{
+	double frameTime = 0.0;
+	double frameWork = 0.0;
+	long framePixels = 0;
+	Uint64 startTime = SDL_GetPerformanceCounter();
+
+	for (long i = 0; i < render->numWork; i++)
+	{
+		DeadlineWork *work = &render->work[i];
+		DeadlineTile *tile = &render->tiles[work->tile];
+
+		if (work->time < 0.0)
+		{
+			continue;
+		}
+
+		double sampleIterations = (double)levelSamples(tile, work->level) *
+								  levelIterations(&render->params,
+												  work->level);
+
+		tile->level = work->level;
+		tile->cost = work->time / sampleIterations;
+		frameTime += work->time;
+		frameWork += sampleIterations;
+		framePixels += (tile->rect.x1 - tile->rect.x0) *
+					   (tile->rect.y1 - tile->rect.y0);
+
+		drawTile(texture, render->colorMap, tile->rect);
+	}
+
+	if (framePixels == 0)
+	{
+		return;
+	}
+
+	double uploadCost = (SDL_GetPerformanceCounter() - startTime) * 1000.0 /
+						SDL_GetPerformanceFrequency() / framePixels;
+
+	/* The first measurements replace the guesses outright. */
+	if (render->averageCost <= 0.0)
+	{
+		render->averageCost = frameTime / frameWork;
+		render->uploadCost = uploadCost;
+	}
+	else
+	{
+		render->averageCost += DEADLINE_SMOOTHING *
+							   (frameTime / frameWork - render->averageCost);
+		render->uploadCost += DEADLINE_SMOOTHING *
+							  (uploadCost - render->uploadCost);
+	}
+}
+
+/**
+@fn compareFrameTimes
+@brief Orders two frame times, for qsort().
+*/
+static int compareFrameTimes (const void *a, const void *b)
+{
+	Uint32 x = *(const Uint32*)a;
+	Uint32 y = *(const Uint32*)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+@fn printFrameStats
+@brief Prints the median, 99th percentile and slowest time of the recent
+frames of a render.
+@param render The tiles of the window.
+@param frameBudget The time (in milliseconds) each frame may take.
+*/
+static void printFrameStats (DeadlineRender *render, int frameBudget)
+{
+	long numFrames = (render->numFrames < DEADLINE_STATS_FRAMES) ?
+					 render->numFrames : DEADLINE_STATS_FRAMES;
+
+	if (numFrames == 0)
+	{
+		return;
+	}
+
+	Uint32 times[DEADLINE_STATS_FRAMES];
+
+	memcpy(times, render->frameTimes, numFrames * sizeof(Uint32));
+	qsort(times, numFrames, sizeof(Uint32), compareFrameTimes);
+
+	long p99 = (numFrames * 99 + 99) / 100 - 1;
+
+	printf("Frames: %ld. Median %.1fms, p99 %.1fms, slowest %.1fms "
+		   "(budget %dms).\n", render->numFrames, times[numFrames / 2] / 1000.0,
+		   times[p99] / 1000.0, times[numFrames - 1] / 1000.0, frameBudget);
+}
+
+/**
+@fn renderDeadline
+@brief Shows a view in the window frame by frame, each frame within
+frameBudget milliseconds, until every tile is shown at full quality or the
+user gives a command.
+@param render The tiles of the window.
+@param params The view to show.
+@param colorMap The color map the view is computed in.
+@param numberOfThreads The number of threads that compute each frame. No
+more threads than CPUs are run.
+@param frameBudget The time (in milliseconds) each frame may take.
+@param renderer The renderer of the window.
+@param texture The texture that shows the color map.
+@param point Pointer to where the pixel that was clicked will be stored.
+@return The command given by the user, or COMMAND_NONE if the view was
+finished.
+*/
+int renderDeadline (DeadlineRender *render, const JuliaParams *params,
+					SDL_Color **colorMap, long numberOfThreads,
+					int frameBudget, SDL_Renderer *renderer,
+					SDL_Texture *texture, SDL_Point *point)
+{
+	double frequency = SDL_GetPerformanceFrequency() / 1000.0;
+	int command = COMMAND_NONE;
+
+	render->params = *params;
+	render->colorMap = colorMap;
+	render->numFrames = 0;
+
+	for (long i = 0; i < render->numTiles; i++)
+	{
+		render->tiles[i].level = DEADLINE_LEVELS;
+		render->tiles[i].cost = 0.0;
+	}
+
+	/* More threads than CPUs do not compute any faster, and the time they
+	   measure for a tile would include the time they spent waiting. */
+	long workers = numberOfThreads;
+	long numCPUs = SDL_GetCPUCount();
+
+	if (numCPUs > 0 && numCPUs < workers)
+	{
+		workers = numCPUs;
+	}
+
+	SDL_Thread *threadList[workers];
+
+	render->numWorkers = workers;
+
+	/* Time one present before the first frame, so that the first frame
+	   already knows how much of the budget showing it takes. */
+	if (render->overhead < 0.0)
+	{
+		Uint64 startTime = SDL_GetPerformanceCounter();
+
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+		SDL_RenderPresent(renderer);
+		render->overhead = (SDL_GetPerformanceCounter() - startTime) /
+						   frequency;
+	}
+
+	while (command == COMMAND_NONE)
+	{
+		Uint64 frameStart = SDL_GetPerformanceCounter();
+
+		/*** Plan the frame from the time that showing it leaves. ***/
+		double computeTime = frameBudget * (1.0 - DEADLINE_MARGIN) -
+							 render->overhead;
+
+		if (computeTime < 0.0)
+		{
+			computeTime = 0.0;
+		}
+
+		double upload = planFrame(render, computeTime * workers);
+
+		if (render->numWork == 0)
+		{
+			break;
+		}
+
+		/*** Compute it, leaving time for the upload. ***/
+		render->stopTime = frameStart;
+
+		if (computeTime > upload)
+		{
+			render->stopTime += (Uint64)((computeTime - upload) * frequency);
+		}
+
+		SDL_AtomicSet(&render->nextWork, 0);
+
+		for (int threadID = 0; threadID < workers; threadID++)
+		{
+			threadList[threadID] = SDL_CreateThread(partialDeadline,
+													"Deadline Thread",
+													(void*)render);
+		}
+		for (int threadID = 0; threadID < workers; threadID++)
+		{
+			SDL_WaitThread(threadList[threadID], NULL);
+		}
+
+		/*** Show it. ***/
+		finishFrame(render, texture);
+
+		Uint64 uploaded = SDL_GetPerformanceCounter();
+
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+		SDL_RenderPresent(renderer);
+
+		Uint64 frameEnd = SDL_GetPerformanceCounter();
+
+		render->overhead += DEADLINE_SMOOTHING *
+							((frameEnd - uploaded) / frequency -
+							 render->overhead);
+		render->frameTimes[render->numFrames++ % DEADLINE_STATS_FRAMES] =
+			(Uint32)((frameEnd - frameStart) * 1000 / frequency);
+
+		command = pollCommand(point);
+	}
+
+	printFrameStats(render, frameBudget);
+
+	return command;
+}
+
+/**
+@fn freeDeadlineRender
+@brief Frees a DeadlineRender.
+@param render The DeadlineRender to be freed.
+*/
+void freeDeadlineRender (DeadlineRender *render)
+{
+	free(render->tiles);
+	free(render->order);
+	free(render->work);
+	free(render);
+}
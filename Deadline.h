@@ -0,0 +1,181 @@
+/**
+@file Deadline.h
+@author Rob Thomas
+@brief Contains functions for showing a Julia set in the window within a fixed
+time per frame, by lowering the quality of the image where needed and
+refining it in later frames.
+@details The window is split into tiles of DEADLINE_TILE_SIZE pixels. Each
+tile is shown at one of DEADLINE_LEVELS quality levels, from full resolution
+with every iteration (level 0) down to blocks of several pixels computed with
+a fraction of the iterations. The cost of a tile at a level is predicted from
+the time per sample and iteration that was measured the last time the tile
+was computed, or from the average of the recent frames for tiles that were
+never computed. The time it takes to upload tiles and present a frame is
+measured as well and kept out of the time for computing.
+
+Every frame first shows the tiles that are not shown yet, at the finest level
+whose predicted cost fits in the frame, and spends what is left of the frame
+on moving other tiles one level up, coarsest tiles first and from the center
+out. Frames go on while the user gives no command, until every tile is at
+level 0. No tile is started that is not predicted to be finished before the
+time for computing runs out.
+*/
+
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "HelperFunctions.h"
+#include "TileQueue.h"
+
+
+/**
+@def DEADLINE_TILE_SIZE
+@brief The width and height (in pixels) of the tiles of the window.
+*/
+#define DEADLINE_TILE_SIZE 32
+
+/**
+@def DEADLINE_LEVELS
+@brief The number of quality levels a tile can be shown at. A tile whose level
+is DEADLINE_LEVELS is not shown yet.
+*/
+#define DEADLINE_LEVELS 4
+
+/**
+@def DEADLINE_MARGIN
+@brief The fraction of each frame that is kept free in case the cost of the
+tiles was underestimated.
+*/
+#define DEADLINE_MARGIN 0.15
+
+/**
+@def DEADLINE_INITIAL_COST
+@brief The time (in milliseconds) per sample and iteration that is assumed
+before anything has been measured.
+*/
+#define DEADLINE_INITIAL_COST 1e-5
+
+/**
+@def DEADLINE_SMOOTHING
+@brief The weight of the newest frame in the running averages of the cost of
+computing and of showing a frame.
+*/
+#define DEADLINE_SMOOTHING 0.25
+
+/**
+@def DEADLINE_STATS_FRAMES
+@brief The number of most recent frames whose times are kept for the
+statistics printed after each render.
+*/
+#define DEADLINE_STATS_FRAMES 1024
+
+
+/**
+@typedef DeadlineTile
+@brief The DeadlineTile struct holds one tile of the window: its rectangle,
+the level it is shown at, and the time per sample and iteration measured the
+last time it was computed (0 if it never was).
+*/
+typedef struct DeadlineTile
+{
+	Tile rect;
+	int level;
+	double cost;
+} DeadlineTile;
+
+/**
+@typedef DeadlineWork
+@brief The DeadlineWork struct describes the computing of one tile at one
+level during a frame. predicted is how long it should take and time how long
+it took (both in milliseconds); time is negative if it was not started.
+*/
+typedef struct DeadlineWork
+{
+	long tile;
+	int level;
+	double predicted;
+	double time;
+} DeadlineWork;
+
+/**
+@typedef DeadlineRender
+@brief The DeadlineRender struct holds the tiles of the window and what has
+been learned about the cost of frames. The worker threads of a frame take
+entries of work from nextWork until there are none left, or until the
+performance counter reaches stopTime. averageCost, uploadCost (the time it
+takes to upload one pixel to the texture) and overhead (the time it takes to
+present a frame) are kept from one view to the next; they are 0, 0 and
+negative until they are first measured.
+*/
+typedef struct DeadlineRender
+{
+	JuliaParams params;
+	SDL_Color **colorMap;
+	long numTiles;
+	DeadlineTile *tiles;
+	long *order;
+	DeadlineWork *work;
+	long numWork;
+	SDL_atomic_t nextWork;
+	Uint64 stopTime;
+	long numWorkers;
+	double averageCost;
+	double uploadCost;
+	double overhead;
+	Uint32 frameTimes[DEADLINE_STATS_FRAMES];
+	long numFrames;
+} DeadlineRender;
+
+
+/**
+@fn newDeadlineRender
+@brief Dynamically allocates the tiles of a window for rendering with a frame
+budget.
+@param windowWidth The width (in pixels) of the window.
+@param windowHeight The height (in pixels) of the window.
+@return The new DeadlineRender, or NULL if it could not be allocated.
+*/
+DeadlineRender * newDeadlineRender (long windowWidth, long windowHeight);
+
+/**
+@fn partialDeadline
+@brief Computes entries of the work of the current frame until none are left.
+Entries that would not be finished before the frame runs out of time are
+skipped.
+@param data A void pointer to be cast into a DeadlineRender struct.
+*/
+int partialDeadline (void *data);
+
+/**
+@fn renderDeadline
+@brief Shows a view in the window frame by frame, each frame within
+frameBudget milliseconds, until every tile is shown at full quality or the
+user gives a command.
+@param render The tiles of the window.
+@param params The view to show.
+@param colorMap The color map the view is computed in.
+@param numberOfThreads The number of threads that compute each frame. No
+more threads than CPUs are run.
+@param frameBudget The time (in milliseconds) each frame may take.
+@param renderer The renderer of the window.
+@param texture The texture that shows the color map.
+@param point Pointer to where the pixel that was clicked will be stored.
+@return The command given by the user, or COMMAND_NONE if the view was
+finished.
+*/
+int renderDeadline (DeadlineRender *render, const JuliaParams *params,
+					SDL_Color **colorMap, long numberOfThreads,
+					int frameBudget, SDL_Renderer *renderer,
+					SDL_Texture *texture, SDL_Point *point);
+
+/**
+@fn freeDeadlineRender
+@brief Frees a DeadlineRender.
+@param render The DeadlineRender to be freed.
+*/
+void freeDeadlineRender (DeadlineRender *render);
+
+#endif /* DEADLINE_H */
@@ -9,6 +9,7 @@ Julia set.
 #include <stdbool.h>
 
 #include "HelperFunctions.h"
+#include "TileQueue.h"
 
 #include "Drawing.h"
 
@@ -105,9 +106,14 @@ SDL_Color ** newColorMap (long windowWidth, long windowHeight)
 {
 	SDL_Color ** colorMap = (SDL_Color**)malloc(sizeof(SDL_Color*) * windowWidth);
 
-	for (int i = 0; i < windowWidth; i++)
+	/* The columns live in one block, which is left untouched so that each
+	   page is placed near the thread that fills it. */
+	SDL_Color *pixels = (SDL_Color*)allocateBuffer(sizeof(SDL_Color) * 
+												   windowWidth * windowHeight);
+
+	for (long i = 0; i < windowWidth; i++)
 	{
-		colorMap[i] = (SDL_Color*)malloc(sizeof(SDL_Color) * windowHeight);
+		colorMap[i] = pixels + i * windowHeight;
 	}
 
 	return colorMap;
@@ -122,12 +128,7 @@ SDL_Color ** newColorMap (long windowWidth, long windowHeight)
 */
 void freeColorMap (SDL_Color ** colorMap, long windowWidth, long windowHeight)
 {
-
-	for (int i = 0; i < windowWidth; i++)
-	{
-		free(colorMap[i]);
-	}
-
+	freeBuffer(colorMap[0], sizeof(SDL_Color) * windowWidth * windowHeight);
 	free(colorMap);
 }
 
@@ -170,6 +171,136 @@ void drawJuliaSet (SDL_Color **colorMap, SDL_Renderer *renderer, long windowWidt
 	SDL_RenderPresent(renderer);
 }
 
+/**
+@fn newColorTexture
+@brief Creates a black texture that color map tiles can be uploaded to with
+drawTile().
+@param renderer The renderer the texture is drawn with.
+@param windowWidth The width (in pixels) of the texture.
+@param windowHeight The height (in pixels) of the texture.
+@return The new texture, or NULL if it could not be created.
+*/
+SDL_Texture * newColorTexture (SDL_Renderer *renderer, long windowWidth,
+							   long windowHeight)
+{
+	SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+											 SDL_TEXTUREACCESS_STREAMING,
+											 (int)windowWidth, 
+											 (int)windowHeight);
+	if (texture == NULL)
+	{
+		return NULL;
+	}
+
+	/* Start out black, like the cleared window of drawJuliaSet(). */
+	SDL_Color *black = (SDL_Color*)calloc(windowWidth * windowHeight, 
+										  sizeof(SDL_Color));
+
+	if (black == NULL)
+	{
+		SDL_DestroyTexture(texture);
+
+		return NULL;
+	}
+
+	for (long i = 0; i < windowWidth * windowHeight; i++)
+	{
+		black[i].a = 255;
+	}
+
+	SDL_UpdateTexture(texture, NULL, black, 
+					  (int)(windowWidth * sizeof(SDL_Color)));
+	free(black);
+
+	return texture;
+}
+
+/**
+@fn drawTile
+@brief Uploads one finished tile of a color map to a texture created with
+newColorTexture().
+@param texture The texture that shows the color map.
+@param colorMap The 2D array of colors describing each pixel in the window.
+@param tile The rectangle of the color map to upload.
+@return true if the tile was uploaded, false otherwise.
+*/
+bool drawTile (SDL_Texture *texture, SDL_Color **colorMap, Tile tile)
+{
+	long width = tile.x1 - tile.x0;
+	long height = tile.y1 - tile.y0;
+
+	if (width <= 0 || height <= 0)
+	{
+		return true;
+	}
+
+	/* Transpose the columns of the tile into the rows of the texture. */
+	SDL_Color *pixels = (SDL_Color*)malloc(sizeof(SDL_Color) * width * height);
+
+	if (pixels == NULL)
+	{
+		return false;
+	}
+
+	for (long x = 0; x < width; x++)
+	{
+		SDL_Color *column = colorMap[tile.x0 + x] + tile.y0;
+
+		for (long y = 0; y < height; y++)
+		{
+			pixels[y * width + x] = column[y];
+		}
+	}
+
+	SDL_Rect rect = {(int)tile.x0, (int)tile.y0, (int)width, (int)height};
+	bool drawn = (SDL_UpdateTexture(texture, &rect, pixels, 
+									(int)(width * sizeof(SDL_Color))) == 0);
+
+	free(pixels);
+
+	return drawn;
+}
+
+/**
+@fn writeColorMap
+@brief Writes a color map to disk as a BMP image.
+@param fileName The name of the file to write.
+@param colorMap The 2D array of colors describing each pixel of the image.
+@param windowWidth The width (in pixels) of the image.
+@param windowHeight The height (in pixels) of the image.
+@return true if the image was written, false otherwise.
+*/
+bool writeColorMap (const char *fileName, SDL_Color **colorMap,
+					long windowWidth, long windowHeight)
+{
+	/* SDL_Color has the same layout as a pixel of an RGBA32 surface, so the
+	   columns of the color map only need to be transposed into rows. */
+	SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, (int)windowWidth,
+														  (int)windowHeight, 32,
+														  SDL_PIXELFORMAT_RGBA32);
+	if (surface == NULL)
+	{
+		return false;
+	}
+
+	for (int y = 0; y < windowHeight; y++)
+	{
+		SDL_Color *row = (SDL_Color*)((Uint8*)surface->pixels + 
+									  (long)y * surface->pitch);
+
+		for (int x = 0; x < windowWidth; x++)
+		{
+			row[x] = colorMap[x][y];
+		}
+	}
+
+	bool written = (SDL_SaveBMP(surface, fileName) == 0);
+
+	SDL_FreeSurface(surface);
+
+	return written;
+}
+
 /**
 @fn colorInSet
 @brief Gives the color of points that are in the Julia set.
@@ -187,6 +318,27 @@ SDL_Color colorInSet ()
 	return color;
 }
 
+/**
+@fn clampColor
+@brief Limits a color component to the range of a Uint8, since deep images 
+have points that escape late enough to run past 255.
+@param value The color component.
+@return The color component, limited to 0 to 255.
+*/
+static Uint8 clampColor (double value)
+{
+	if (value < 0.0)
+	{
+		return 0;
+	}
+	if (value > 255.0)
+	{
+		return 255;
+	}
+
+	return (Uint8)value;
+}
+
 /**
 @fn colorOutOfSet
 @brief Gives the color of points that are outside of the Julia set.
@@ -199,10 +351,46 @@ SDL_Color colorOutOfSet (int stageEliminated)
 {
 	SDL_Color color;
 
-	color.r = RED_OUTOF_SET + (RED_DELTA * stageEliminated);
-	color.g = GREEN_OUTOF_SET + (GREEN_DELTA * stageEliminated);
-	color.b = BLUE_OUTOF_SET + (BLUE_DELTA * stageEliminated);
-	color.a = OPACITY_OUTOF_SET + (OPACITY_DELTA * stageEliminated);
+	color.r = clampColor(RED_OUTOF_SET + (RED_DELTA * stageEliminated));
+	color.g = clampColor(GREEN_OUTOF_SET + (GREEN_DELTA * stageEliminated));
+	color.b = clampColor(BLUE_OUTOF_SET + (BLUE_DELTA * stageEliminated));
+	color.a = clampColor(OPACITY_OUTOF_SET + (OPACITY_DELTA * stageEliminated));
+
+	return color;
+}
+
+/**
+@fn colorFromDistance
+@brief Gives the color of a point from its estimated distance to the Julia set.
+@details Points within BOUNDARY_WIDTH pixels of the set are drawn in the
+boundary color, fading into the color of points outside of the set, so the
+boundary stays visible even where it is thinner than a pixel.
+@param distance The estimated distance (in units) from the point to the Julia
+set, or a negative number if the point is in the set.
+@param pixelSize The size (in units) of one pixel.
+@return An SDL_Color struct representing the color of the point.
+*/
+SDL_Color colorFromDistance (double distance, double pixelSize)
+{
+	if (distance < 0.0)
+	{
+		return colorInSet();
+	}
+
+	/* t goes from 0 on the boundary to 1 at BOUNDARY_WIDTH pixels away. */
+	double t = distance / (BOUNDARY_WIDTH * pixelSize);
+
+	if (t > 1.0)
+	{
+		t = 1.0;
+	}
+
+	SDL_Color color;
+
+	color.r = RED_BOUNDARY + t * (RED_OUTOF_SET - RED_BOUNDARY);
+	color.g = GREEN_BOUNDARY + t * (GREEN_OUTOF_SET - GREEN_BOUNDARY);
+	color.b = BLUE_BOUNDARY + t * (BLUE_OUTOF_SET - BLUE_BOUNDARY);
+	color.a = OPACITY_OUTOF_SET;
 
 	return color;
 }
\ No newline at end of file
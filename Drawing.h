@@ -9,6 +9,9 @@ Julia set.
 #define DRAWING_H
 
 #include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#include "TileQueue.h"
 
 
 /**
@@ -90,6 +93,35 @@ Julia set by for each iteration it passed.
 #define OPACITY_DELTA 0
 
 
+/**
+@def RED_BOUNDARY
+@brief The value of red for a point on the boundary of the Julia set when 
+coloring by distance.
+*/
+#define RED_BOUNDARY 255
+
+/**
+@def GREEN_BOUNDARY
+@brief The value of green for a point on the boundary of the Julia set when 
+coloring by distance.
+*/
+#define GREEN_BOUNDARY 230
+
+/**
+@def BLUE_BOUNDARY
+@brief The value of blue for a point on the boundary of the Julia set when 
+coloring by distance.
+*/
+#define BLUE_BOUNDARY 160
+
+/**
+@def BOUNDARY_WIDTH
+@brief The distance (in pixels) from the Julia set over which the boundary
+color fades into the color of points outside of the set.
+*/
+#define BOUNDARY_WIDTH 1.5
+
+
 /**
 @fn drawJuliaSet
 @brief Draws the Julia set described by colorMap.
@@ -146,6 +178,42 @@ SDL_Color ** newColorMap (long windowWidth, long windowHeight);
 
 
 
+/**
+@fn newColorTexture
+@brief Creates a black texture that color map tiles can be uploaded to with
+drawTile().
+@param renderer The renderer the texture is drawn with.
+@param windowWidth The width (in pixels) of the texture.
+@param windowHeight The height (in pixels) of the texture.
+@return The new texture, or NULL if it could not be created.
+*/
+SDL_Texture * newColorTexture (SDL_Renderer *renderer, long windowWidth,
+							   long windowHeight);
+
+/**
+@fn drawTile
+@brief Uploads one finished tile of a color map to a texture created with
+newColorTexture().
+@param texture The texture that shows the color map.
+@param colorMap The 2D array of colors describing each pixel in the window.
+@param tile The rectangle of the color map to upload.
+@return true if the tile was uploaded, false otherwise.
+*/
+bool drawTile (SDL_Texture *texture, SDL_Color **colorMap, Tile tile);
+
+/**
+@fn writeColorMap
+@brief Writes a color map to disk as a BMP image.
+@param fileName The name of the file to write.
+@param colorMap The 2D array of colors describing each pixel of the image.
+@param windowWidth The width (in pixels) of the image.
+@param windowHeight The height (in pixels) of the image.
+@return true if the image was written, false otherwise.
+*/
+bool writeColorMap (const char *fileName, SDL_Color **colorMap,
+					long windowWidth, long windowHeight);
+
+
 /**
 @fn colorInSet
 @brief Gives the color of points that are in the Julia set.
@@ -163,5 +231,18 @@ Julia set.
 */
 SDL_Color colorOutOfSet (int stageEliminated);
 
+/**
+@fn colorFromDistance
+@brief Gives the color of a point from its estimated distance to the Julia set.
+@details Points within BOUNDARY_WIDTH pixels of the set are drawn in the
+boundary color, fading into the color of points outside of the set, so the
+boundary stays visible even where it is thinner than a pixel.
+@param distance The estimated distance (in units) from the point to the Julia
+set, or a negative number if the point is in the set.
+@param pixelSize The size (in units) of one pixel.
+@return An SDL_Color struct representing the color of the point.
+*/
+SDL_Color colorFromDistance (double distance, double pixelSize);
+
 
 #endif /* DRAWING_H */
\ No newline at end of file
@@ -4,14 +4,28 @@
 @brief Contains functions for ingesting input and processing the Julia set.
 */
 
+/* Thread affinity and madvise() are GNU extensions on Linux. */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
 
 #include <complex.h>
+#include <limits.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#include "JuliaSet.h"
 #include "HelperFunctions.h"
 
 
+
 /**
 @fn getArgs
 @brief Ingests the command line arguments provided by the user.
@@ -24,7 +38,8 @@
 @param centerX Pointer to where centerX will be stored.
 @param centerY Pointer to where centerY will be stored.
 @param C Pointer to where the complex constant c will be stored.
-@param numberOfThreads Pointer to where the number of threads will be stored.
+@param numberOfThreads Pointer to where the number of threads will be stored,
+or AUTO_THREADS if argument 9 is "auto".
 @return An error code. 0 if operation was successful. 
 */
 int getArgs (int argc, char *argv[], long *windowWidth, long *windowHeight, 
@@ -51,7 +66,8 @@ int getArgs (int argc, char *argv[], long *windowWidth, long *windowHeight,
 	*centerY = strtod(argv[6], &endptr);
 	double a = strtod(argv[7], &endptr);
 	double b = strtod(argv[8], &endptr);
-	*numberOfThreads = strtol(argv[9], &endptr, 10);
+	*numberOfThreads = (strcmp(argv[9], "auto") == 0) ? AUTO_THREADS :
+					   strtol(argv[9], &endptr, 10);
 
 	/*** Check for non-numbers being input by the user. ***/
 	if ( (*windowWidth == 0 && argv[1][0] != '0')    || 
@@ -62,7 +78,8 @@ int getArgs (int argc, char *argv[], long *windowWidth, long *windowHeight,
 		 (*centerY == 0 && argv[6][0] != '0')		 ||
 		 (a == 0 && argv[7][0] != '0')				 ||
 		 (b == 0 && argv[8][0] != '0')				 ||
-		 (*numberOfThreads == 0 && argv[9][0] != '0')  )
+		 (*numberOfThreads == 0 && argv[9][0] != '0' &&
+		  strcmp(argv[9], "auto") != 0)  )
 	{
 		fprintf(stderr, "Non-number arg given. All args must be numbers.\n");
 
@@ -83,9 +100,10 @@ int getArgs (int argc, char *argv[], long *windowWidth, long *windowHeight,
 
 		return ARG_BELOW_ONE_FAIL;
 	}
-	else if (*numberOfThreads <= 0)
+	else if (*numberOfThreads <= 0 && strcmp(argv[9], "auto") != 0)
 	{
-		fprintf(stderr, "Number of threads (arg 9) must be greater than 0.\n");
+		fprintf(stderr, "Number of threads (arg 9) must be greater than 0 "
+				"or auto.\n");
 
 		return ARG_BELOW_ONE_FAIL;
 	}
@@ -102,6 +120,403 @@ int getArgs (int argc, char *argv[], long *windowWidth, long *windowHeight,
 	return GET_ARGS_SUCCEED;
 }
 
+/**
+@fn getOptions
+@brief Ingests the optional command line arguments that follow the required ones.
+@details Recognized options are:
+	--map=NAME: the iteration map to use. NAME is one of z2 (the default), z3,
+				z4, z5, z6, z7, z8, burningship or cubic.
+	--coloring=MODE: how points are colored. MODE is escape (by escape time,
+					 the default) or distance (by the estimated distance to the
+					 set, which keeps thin filaments visible).
+	--renderer=NAME: compute the image with the renderer NAME: escape (iterate
+					 every pixel, the default), miim (plot the boundary by
+					 inverse iteration, only for the maps z2 to z8) or auto
+					 (miim for Julia sets that are dust, escape otherwise).
+	--pin=POLICY: pin each worker thread to one CPU. POLICY is spread (spread
+				  threads over the sockets) or compact (fill one socket first).
+				  Each thread then works on large contiguous chunks of the
+				  image, so the memory it writes is placed on its own socket.
+	--kernel=NAME: compute images colored by escape time with the kernel
+				   NAME: scalar (one pixel at a time), vector (several rows
+				   at once in vector registers) or auto (the default: the
+				   kernel chosen by --autotune, or scalar if it was never
+				   run).
+	--tile=COLUMNS: the number of columns each thread takes at once (by
+					default the size chosen by --autotune).
+	--output=FILE: write the image to the file FILE instead of opening a
+				   window. FILE is written as a PNG image if its name ends in
+				   .png, and as a BMP image otherwise.
+	--checkpoint=FILE: with --output, save the finished parts of the image to
+					   FILE as the render goes, so that an interrupted render
+					   can be resumed.
+	--checkpoint-interval=SECONDS: how often the checkpoint is saved (60 by
+								   default). At most this much work is lost
+								   when a render is interrupted.
+	--resume: continue the render saved in the checkpoint file instead of
+			  starting over.
+	--frame-budget=MS: show the window frame by frame, each frame within MS
+					   milliseconds, by computing parts of the image at a lower
+					   resolution and with fewer iterations first and refining
+					   them in later frames.
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param firstOption The index in argv of the first optional argument.
+@param options Pointer to where the options will be stored. Options that are
+not given keep their default values.
+@return An error code. 0 if operation was successful.
+*/
+int getOptions (int argc, char *argv[], int firstOption, RenderOptions *options)
+{
+	/*** Set the defaults for any options that are not given. ***/
+	options->map = MAP_QUADRATIC;
+	options->coloring = COLOR_ESCAPE_TIME;
+	options->renderer = RENDERER_ESCAPE_TIME;
+	options->pinning = PIN_NONE;
+	options->kernel = KERNEL_AUTO;
+	options->tileColumns = 0;
+	options->outputFile = NULL;
+	options->checkpointFile = NULL;
+	options->checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL;
+	options->resume = false;
+	options->frameBudget = 0;
+
+	for (int i = firstOption; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--map=", 6) == 0)
+		{
+			options->map = juliaMapFromName(argv[i] + 6);
+
+			if (options->map == NUM_JULIA_MAPS)
+			{
+				fprintf(stderr, "Unknown map '%s'.\n", argv[i] + 6);
+
+				return UNKNOWN_OPTION_FAIL;
+			}
+		}
+		else if (strcmp(argv[i], "--coloring=escape") == 0)
+		{
+			options->coloring = COLOR_ESCAPE_TIME;
+		}
+		else if (strcmp(argv[i], "--coloring=distance") == 0)
+		{
+			options->coloring = COLOR_DISTANCE;
+		}
+		else if (strcmp(argv[i], "--renderer=auto") == 0)
+		{
+			options->renderer = RENDERER_AUTO;
+		}
+		else if (strcmp(argv[i], "--renderer=escape") == 0)
+		{
+			options->renderer = RENDERER_ESCAPE_TIME;
+		}
+		else if (strcmp(argv[i], "--renderer=miim") == 0)
+		{
+			options->renderer = RENDERER_INVERSE;
+		}
+		else if (strcmp(argv[i], "--pin=spread") == 0)
+		{
+			options->pinning = PIN_SPREAD;
+		}
+		else if (strcmp(argv[i], "--pin=compact") == 0)
+		{
+			options->pinning = PIN_COMPACT;
+		}
+		else if (strcmp(argv[i], "--kernel=auto") == 0)
+		{
+			options->kernel = KERNEL_AUTO;
+		}
+		else if (strcmp(argv[i], "--kernel=scalar") == 0)
+		{
+			options->kernel = KERNEL_SCALAR;
+		}
+		else if (strcmp(argv[i], "--kernel=vector") == 0)
+		{
+			options->kernel = KERNEL_VECTOR;
+		}
+		else if (strncmp(argv[i], "--tile=", 7) == 0)
+		{
+			char *endptr = NULL;
+			long columns = strtol(argv[i] + 7, &endptr, 10);
+
+			if (endptr == argv[i] + 7 || *endptr != '\0')
+			{
+				fprintf(stderr, "The tile size must be a number.\n");
+
+				return ARG_NOT_A_NUMBER_FAIL;
+			}
+			if (columns < 1)
+			{
+				fprintf(stderr, "The tile size must be at least one "
+						"column.\n");
+
+				return ARG_BELOW_ONE_FAIL;
+			}
+
+			options->tileColumns = columns;
+		}
+		else if (strncmp(argv[i], "--output=", 9) == 0 && argv[i][9] != '\0')
+		{
+			options->outputFile = argv[i] + 9;
+		}
+		else if (strncmp(argv[i], "--checkpoint=", 13) == 0 && 
+				 argv[i][13] != '\0')
+		{
+			options->checkpointFile = argv[i] + 13;
+		}
+		else if (strncmp(argv[i], "--checkpoint-interval=", 22) == 0)
+		{
+			char *endptr = NULL;
+			long interval = strtol(argv[i] + 22, &endptr, 10);
+
+			if (endptr == argv[i] + 22 || *endptr != '\0')
+			{
+				fprintf(stderr, "The checkpoint interval must be a number.\n");
+
+				return ARG_NOT_A_NUMBER_FAIL;
+			}
+			if (interval < 1)
+			{
+				fprintf(stderr, "The checkpoint interval must be at least one "
+						"second.\n");
+
+				return ARG_BELOW_ONE_FAIL;
+			}
+			if (interval > INT_MAX / 1000)
+			{
+				fprintf(stderr, "The checkpoint interval must be at most %d "
+						"seconds.\n", INT_MAX / 1000);
+
+				return UNKNOWN_OPTION_FAIL;
+			}
+
+			options->checkpointInterval = (int)interval;
+		}
+		else if (strcmp(argv[i], "--resume") == 0)
+		{
+			options->resume = true;
+		}
+		else if (strncmp(argv[i], "--frame-budget=", 15) == 0)
+		{
+			char *endptr = NULL;
+			long budget = strtol(argv[i] + 15, &endptr, 10);
+
+			if (endptr == argv[i] + 15 || *endptr != '\0')
+			{
+				fprintf(stderr, "The frame budget must be a number.\n");
+
+				return ARG_NOT_A_NUMBER_FAIL;
+			}
+			if (budget < 1)
+			{
+				fprintf(stderr, "The frame budget must be at least one "
+						"millisecond.\n");
+
+				return ARG_BELOW_ONE_FAIL;
+			}
+			if (budget > INT_MAX / 1000)
+			{
+				fprintf(stderr, "The frame budget must be at most %d "
+						"milliseconds.\n", INT_MAX / 1000);
+
+				return UNKNOWN_OPTION_FAIL;
+			}
+
+			options->frameBudget = (int)budget;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown option '%s'.\n", argv[i]);
+
+			return UNKNOWN_OPTION_FAIL;
+		}
+	}
+
+	return GET_ARGS_SUCCEED;
+}
+
+/**
+@fn cpuPackage
+@brief Gives the socket (physical package) that a CPU belongs to.
+@param cpu The index of the CPU.
+@return The index of the socket, or 0 if it is not known.
+*/
+static int cpuPackage (int cpu)
+{
+	char path[128];
+	int package = 0;
+
+	sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id",
+			cpu);
+
+	FILE *file = fopen(path, "r");
+
+	if (file != NULL)
+	{
+		if (fscanf(file, "%d", &package) != 1)
+		{
+			package = 0;
+		}
+
+		fclose(file);
+	}
+
+	return package;
+}
+
+/**
+@fn pinThread
+@brief Pins the calling thread to one of the CPUs the process may run on.
+@param threadID The index of the calling thread among the worker threads.
+@param policy How threads are spread over the CPUs.
+@return true if the thread was pinned, false if pinning is not supported or
+failed.
+*/
+bool pinThread (int threadID, PinPolicy policy)
+{
+#ifdef __linux__
+	cpu_set_t allowed;
+
+	if (policy == PIN_NONE || 
+		sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+	{
+		return false;
+	}
+
+	/*** List the allowed CPUs and the socket of each one. ***/
+	int numCPUs = CPU_COUNT(&allowed);
+	int cpus[numCPUs], packages[numCPUs];
+	int n = 0, numPackages = 0;
+
+	for (int cpu = 0; cpu < CPU_SETSIZE && n < numCPUs; cpu++)
+	{
+		if (CPU_ISSET(cpu, &allowed))
+		{
+			cpus[n] = cpu;
+			packages[n] = cpuPackage(cpu);
+
+			if (packages[n] + 1 > numPackages)
+			{
+				numPackages = packages[n] + 1;
+			}
+
+			n++;
+		}
+	}
+
+	/*** Order the CPUs so that thread i takes CPU i of the order. Compact
+		 lists every CPU of socket 0 first, then socket 1, and so on; spread
+		 takes one CPU of each socket in turn. ***/
+	int order[numCPUs];
+	int numOrdered = 0;
+
+	if (policy == PIN_COMPACT)
+	{
+		for (int package = 0; package < numPackages; package++)
+		{
+			for (int i = 0; i < numCPUs; i++)
+			{
+				if (packages[i] == package)
+				{
+					order[numOrdered++] = cpus[i];
+				}
+			}
+		}
+	}
+	else
+	{
+		int taken[numCPUs];
+
+		memset(taken, 0, sizeof(taken));
+
+		while (numOrdered < numCPUs)
+		{
+			for (int package = 0; package < numPackages; package++)
+			{
+				for (int i = 0; i < numCPUs; i++)
+				{
+					if (!taken[i] && packages[i] == package)
+					{
+						taken[i] = 1;
+						order[numOrdered++] = cpus[i];
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	/*** Pin the calling thread. ***/
+	cpu_set_t pinned;
+
+	CPU_ZERO(&pinned);
+	CPU_SET(order[threadID % numCPUs], &pinned);
+
+	return (sched_setaffinity(0, sizeof(pinned), &pinned) == 0);
+#else
+	(void)threadID;
+	(void)policy;
+
+	return false;
+#endif
+}
+
+/**
+@fn allocateBuffer
+@brief Allocates a zero-filled buffer for large images. The memory is not
+touched, so each page is placed near the thread that first writes to it, and
+large buffers are backed by huge pages where the system supports it.
+@param size The size of the buffer in bytes.
+@return The buffer, or NULL if it could not be allocated.
+*/
+void * allocateBuffer (size_t size)
+{
+#ifdef __linux__
+	if (size >= (size_t)HUGE_PAGE_SIZE)
+	{
+		/* Fresh anonymous pages are zero and get their physical memory on
+		   the first write. */
+		void *buffer = mmap(NULL, size, PROT_READ | PROT_WRITE,
+							MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (buffer == MAP_FAILED)
+		{
+			return NULL;
+		}
+
+#ifdef MADV_HUGEPAGE
+		madvise(buffer, size, MADV_HUGEPAGE);
+#endif
+
+		return buffer;
+	}
+#endif
+
+	return calloc(1, size);
+}
+
+/**
+@fn freeBuffer
+@brief Frees a buffer allocated with allocateBuffer().
+@param buffer The buffer to free.
+@param size The size of the buffer in bytes, as passed to allocateBuffer().
+*/
+void freeBuffer (void *buffer, size_t size)
+{
+#ifdef __linux__
+	if (size >= (size_t)HUGE_PAGE_SIZE)
+	{
+		munmap(buffer, size);
+
+		return;
+	}
+#endif
+
+	(void)size;
+
+	free(buffer);
+}
+
 /**
 @fn XTransform
 @brief Converts window coordinates (x = 0 is left of window) into complex
@@ -159,4 +574,199 @@ int waitForClose ()
 	} while (event.type != SDL_QUIT);
 
 	return 0;
+}
+
+/**
+@fn commandFromEvent
+@brief Translates an event into the command it gives.
+@param event The event.
+@param point Pointer to where the pixel that was clicked will be stored for
+COMMAND_ZOOM_IN and COMMAND_ZOOM_OUT.
+@return One of the COMMAND_ codes, or COMMAND_NONE if the event is not a
+command.
+*/
+static int commandFromEvent (const SDL_Event *event, SDL_Point *point)
+{
+	if (event->type == SDL_QUIT)
+	{
+		return COMMAND_QUIT;
+	}
+
+	if (event->type == SDL_MOUSEBUTTONDOWN)
+	{
+		point->x = event->button.x;
+		point->y = event->button.y;
+
+		if (event->button.button == SDL_BUTTON_LEFT)
+		{
+			return COMMAND_ZOOM_IN;
+		}
+		if (event->button.button == SDL_BUTTON_RIGHT)
+		{
+			return COMMAND_ZOOM_OUT;
+		}
+	}
+
+	if (event->type == SDL_KEYDOWN)
+	{
+		switch (event->key.keysym.sym)
+		{
+			case SDLK_d:
+				return COMMAND_DEEPEN;
+			case SDLK_LEFT:
+				return COMMAND_PAN_LEFT;
+			case SDLK_RIGHT:
+				return COMMAND_PAN_RIGHT;
+			case SDLK_UP:
+				return COMMAND_PAN_UP;
+			case SDLK_DOWN:
+				return COMMAND_PAN_DOWN;
+			case SDLK_BACKSPACE:
+				return COMMAND_BACK;
+		}
+	}
+
+	return COMMAND_NONE;
+}
+
+/**
+@fn waitForCommand
+@brief Waits until the user closes the window or asks for a change to the
+image.
+@param point Pointer to where the pixel that was clicked will be stored for
+COMMAND_ZOOM_IN and COMMAND_ZOOM_OUT.
+@return The command given by the user (one of the COMMAND_ codes), or 
+COMMAND_ERROR if waiting failed.
+*/
+int waitForCommand (SDL_Point *point)
+{
+	SDL_Event event;
+	int command = COMMAND_NONE;
+
+	while (command == COMMAND_NONE)
+	{
+		if (SDL_WaitEvent(&event) == 0)
+		{
+			return COMMAND_ERROR;
+		}
+
+		command = commandFromEvent(&event, point);
+	}
+
+	return command;
+}
+
+/**
+@fn pollCommand
+@brief Handles the events that are waiting, without waiting for more.
+@param point Pointer to where the pixel that was clicked will be stored for
+COMMAND_ZOOM_IN and COMMAND_ZOOM_OUT.
+@return The first command given by the user (one of the COMMAND_ codes), or
+COMMAND_NONE if none of the waiting events was a command.
+*/
+int pollCommand (SDL_Point *point)
+{
+	SDL_Event event;
+	int command = COMMAND_NONE;
+
+	while (command == COMMAND_NONE && SDL_PollEvent(&event))
+	{
+		command = commandFromEvent(&event, point);
+	}
+
+	return command;
+}
+
+/**
+@fn putU32
+@brief Stores a 32-bit number in little-endian byte order.
+@param bytes Where the number is stored.
+@param value The number.
+*/
+void putU32 (Uint8 *bytes, Uint32 value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		bytes[i] = (Uint8)(value >> (8 * i));
+	}
+}
+
+/**
+@fn putU64
+@brief Stores a 64-bit number in little-endian byte order.
+@param bytes Where the number is stored.
+@param value The number.
+*/
+void putU64 (Uint8 *bytes, Uint64 value)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		bytes[i] = (Uint8)(value >> (8 * i));
+	}
+}
+
+/**
+@fn putDouble
+@brief Stores a double as the little-endian bytes of its bit pattern.
+@param bytes Where the number is stored.
+@param value The number.
+*/
+void putDouble (Uint8 *bytes, double value)
+{
+	Uint64 bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	putU64(bytes, bits);
+}
+
+/**
+@fn getU32
+@brief Reads a 32-bit number stored in little-endian byte order.
+@param bytes Where the number is stored.
+@return The number.
+*/
+Uint32 getU32 (const Uint8 *bytes)
+{
+	Uint32 value = 0;
+
+	for (int i = 0; i < 4; i++)
+	{
+		value |= (Uint32)bytes[i] << (8 * i);
+	}
+
+	return value;
+}
+
+/**
+@fn getU64
+@brief Reads a 64-bit number stored in little-endian byte order.
+@param bytes Where the number is stored.
+@return The number.
+*/
+Uint64 getU64 (const Uint8 *bytes)
+{
+	Uint64 value = 0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		value |= (Uint64)bytes[i] << (8 * i);
+	}
+
+	return value;
+}
+
+/**
+@fn getDouble
+@brief Reads a double stored as the little-endian bytes of its bit pattern.
+@param bytes Where the number is stored.
+@return The number.
+*/
+double getDouble (const Uint8 *bytes)
+{
+	Uint64 bits = getU64(bytes);
+	double value;
+
+	memcpy(&value, &bits, sizeof(value));
+
+	return value;
 }
\ No newline at end of file
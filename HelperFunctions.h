@@ -8,8 +8,13 @@
 #define HELPERFUNCTIONS_H
 
 #include <complex.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <SDL2/SDL.h>
 
+#include "JuliaTypes.h"
+#include "TileQueue.h"
+
 
 /**
 @def GET_ARGS_SUCCEED
@@ -39,20 +44,226 @@ any one of the command line arguments.
 */
 #define ARG_NOT_A_NUMBER_FAIL 4
 
+/**
+@def UNKNOWN_OPTION_FAIL
+@brief Error code indicating that an optional argument was not recognized or
+had an invalid value.
+*/
+#define UNKNOWN_OPTION_FAIL 5
+
+
+/**
+@def COMMAND_QUIT
+@brief Command returned by waitForCommand() when the user closed the window.
+*/
+#define COMMAND_QUIT 0
+
+/**
+@def COMMAND_ERROR
+@brief Command returned by waitForCommand() when waiting for events failed.
+*/
+#define COMMAND_ERROR 1
+
+/**
+@def COMMAND_DEEPEN
+@brief Command returned by waitForCommand() when the user asked for more
+iterations (by pressing D).
+*/
+#define COMMAND_DEEPEN 2
+
+/**
+@def COMMAND_NONE
+@brief Command returned by pollCommand() when the user has not given any
+command.
+*/
+#define COMMAND_NONE 3
+
+/**
+@def COMMAND_ZOOM_IN
+@brief Command returned when the user asked to zoom in on a point (by clicking
+it with the left mouse button).
+*/
+#define COMMAND_ZOOM_IN 4
+
+/**
+@def COMMAND_ZOOM_OUT
+@brief Command returned when the user asked to zoom out around a point (by
+clicking it with the right mouse button).
+*/
+#define COMMAND_ZOOM_OUT 5
+
+/**
+@def COMMAND_PAN_LEFT
+@brief Command returned when the user asked to move the view left (by
+pressing the left arrow key).
+*/
+#define COMMAND_PAN_LEFT 6
+
+/**
+@def COMMAND_PAN_RIGHT
+@brief Command returned when the user asked to move the view right (by
+pressing the right arrow key).
+*/
+#define COMMAND_PAN_RIGHT 7
+
+/**
+@def COMMAND_PAN_UP
+@brief Command returned when the user asked to move the view up (by pressing
+the up arrow key).
+*/
+#define COMMAND_PAN_UP 8
+
+/**
+@def COMMAND_PAN_DOWN
+@brief Command returned when the user asked to move the view down (by
+pressing the down arrow key).
+*/
+#define COMMAND_PAN_DOWN 9
+
+/**
+@def COMMAND_BACK
+@brief Command returned when the user asked to go back to the previous view
+(by pressing backspace).
+*/
+#define COMMAND_BACK 10
+
+
+/**
+@def HUGE_PAGE_SIZE
+@brief Buffers of at least this many bytes are backed by huge pages where the
+system supports it.
+*/
+#define HUGE_PAGE_SIZE (2L * 1024 * 1024)
+
+/**
+@def AUTO_THREADS
+@brief The number of threads stored by getArgs() when argument 9 is "auto",
+i.e. when the number of threads is taken from the profile written by
+--autotune.
+*/
+#define AUTO_THREADS 0
+
+/**
+@def DEFAULT_CHECKPOINT_INTERVAL
+@brief The number of seconds between two checkpoints of a render when
+--checkpoint-interval is not given.
+*/
+#define DEFAULT_CHECKPOINT_INTERVAL 60
+
+/**
+@typedef JuliaRenderer
+@brief Identifies the algorithm that computes a Julia set image.
+*/
+typedef enum JuliaRenderer
+{
+	RENDERER_AUTO,			/* Chosen per image by chooseJuliaRenderer(). */
+	RENDERER_ESCAPE_TIME,	/* Iterate every pixel until it escapes. */
+	RENDERER_INVERSE		/* Plot the boundary by inverse iteration. */
+} JuliaRenderer;
+
+/**
+@typedef JuliaKernel
+@brief Identifies the kernel that computes the pixels of an image colored by
+escape time. Which one is faster depends on the machine (see Autotune.h).
+*/
+typedef enum JuliaKernel
+{
+	KERNEL_AUTO,	/* Taken from the profile written by --autotune. */
+	KERNEL_SCALAR,	/* One pixel at a time. */
+	KERNEL_VECTOR	/* JULIA_LANES pixels of a column side by side. */
+} JuliaKernel;
+
+/**
+@typedef PinPolicy
+@brief Identifies how worker threads are pinned to CPUs.
+*/
+typedef enum PinPolicy
+{
+	PIN_NONE,		/* Threads may run on any CPU. */
+	PIN_SPREAD,		/* Consecutive threads go to different sockets. */
+	PIN_COMPACT		/* Threads fill up one socket before the next. */
+} PinPolicy;
+
+/**
+@typedef RenderOptions
+@brief The RenderOptions struct holds the optional settings that may follow the
+nine required command line arguments, each given in the form --name=value.
+A tileColumns of 0 leaves the tile size to main(), and a frameBudget of 0
+shows renders without a frame budget.
+*/
+typedef struct RenderOptions
+{
+	JuliaMap map;
+	ColoringMode coloring;
+	JuliaRenderer renderer;
+	PinPolicy pinning;
+	JuliaKernel kernel;
+	long tileColumns;
+	char *outputFile;
+	char *checkpointFile;
+	int checkpointInterval;
+	bool resume;
+	int frameBudget;
+} RenderOptions;
+
+/**
+@typedef JuliaParams
+@brief The JuliaParams struct describes one image of a Julia set: the slice of
+the complex plane it shows, its size in pixels, the map being iterated, how
+it is colored, which renderer computes it (never RENDERER_AUTO) and with
+which kernel (never KERNEL_AUTO).
+*/
+typedef struct JuliaParams
+{
+	double centerX, centerY, planeWidth, planeHeight;
+	double complex C;
+	long windowWidth, windowHeight;
+	int numIterations;
+	JuliaMap map;
+	ColoringMode coloring;
+	JuliaRenderer renderer;
+	JuliaKernel kernel;
+} JuliaParams;
+
+
+/**
+@typedef OrbitState
+@brief The OrbitState struct keeps where the orbit of one pixel stopped, so
+that a later fill with more iterations can continue it instead of starting
+over. iterations is 0 for an orbit that has not been started. Otherwise stage
+is the iteration at which the orbit escaped, or ORBIT_BOUNDED or ORBIT_SETTLED
+(see JuliaSet.h).
+*/
+typedef struct OrbitState
+{
+	double zr, zi;
+	int iterations, stage;
+} OrbitState;
 
 /**
 @typedef ThreadData
 @brief The ThreadData struct contains data members necessary for implementing
 multithreading in the Julia set problem. It is used for transmitting data to 
-newly created threads.
+newly created threads. Each thread fills every numberOfThreads-th chunk of
+chunkColumns columns, starting at chunk threadID, and pushes each finished
+chunk to tiles unless it is NULL. The thread stops early once the counter
+pointed to by generation no longer equals renderGeneration, i.e. once a newer
+render has replaced this one. generation may be NULL for renders that are
+never cancelled. Columns x for which finishedColumns[x] is true were restored
+from a checkpoint and are skipped; finishedColumns may be NULL.
 */
 typedef struct ThreadData
 {
-	double centerX, centerY, planeWidth, planeHeight;
-	double complex C;
-	long windowWidth, windowHeight;
-	int threadID, numberOfThreads, numIterations;
+	JuliaParams params;
+	int threadID, numberOfThreads;
+	PinPolicy pinning;
+	long chunkColumns;
 	SDL_Color ***colorMapPtr;
+	OrbitState ***orbitMapPtr;
+	TileQueue *tiles;
+	SDL_atomic_t *generation;
+	int renderGeneration;
+	const bool *finishedColumns;
 } ThreadData;
 
 /**
@@ -67,13 +278,90 @@ typedef struct ThreadData
 @param centerX Pointer to where centerX will be stored.
 @param centerY Pointer to where centerY will be stored.
 @param C Pointer to where the complex constant c will be stored.
-@param numberOfThreads Pointer to where the number of threads will be stored.
+@param numberOfThreads Pointer to where the number of threads will be stored,
+or AUTO_THREADS if argument 9 is "auto".
 @return An error code. 0 if operation was successful. 
 */
 int getArgs (int argc, char *argv[], long *windowWidth, long *windowHeight, 
 			 double *planeWidth, double *planeHeight, double *centerX, 
 			 double *centerY, double complex *C, long *numberOfThreads);
 
+/**
+@fn getOptions
+@brief Ingests the optional command line arguments that follow the required ones.
+@details Recognized options are:
+	--map=NAME: the iteration map to use. NAME is one of z2 (the default), z3,
+				z4, z5, z6, z7, z8, burningship or cubic.
+	--coloring=MODE: how points are colored. MODE is escape (by escape time,
+					 the default) or distance (by the estimated distance to the
+					 set, which keeps thin filaments visible).
+	--renderer=NAME: compute the image with the renderer NAME: escape (iterate
+					 every pixel, the default), miim (plot the boundary by
+					 inverse iteration, only for the maps z2 to z8) or auto
+					 (miim for Julia sets that are dust, escape otherwise).
+	--pin=POLICY: pin each worker thread to one CPU. POLICY is spread (spread
+				  threads over the sockets) or compact (fill one socket first).
+				  Each thread then works on large contiguous chunks of the
+				  image, so the memory it writes is placed on its own socket.
+	--kernel=NAME: compute images colored by escape time with the kernel
+				   NAME: scalar (one pixel at a time), vector (several rows
+				   at once in vector registers) or auto (the default: the
+				   kernel chosen by --autotune, or scalar if it was never
+				   run).
+	--tile=COLUMNS: the number of columns each thread takes at once (by
+					default the size chosen by --autotune).
+	--output=FILE: write the image to the file FILE instead of opening a
+				   window. FILE is written as a PNG image if its name ends in
+				   .png, and as a BMP image otherwise.
+	--checkpoint=FILE: with --output, save the finished parts of the image to
+					   FILE as the render goes, so that an interrupted render
+					   can be resumed.
+	--checkpoint-interval=SECONDS: how often the checkpoint is saved (60 by
+								   default). At most this much work is lost
+								   when a render is interrupted.
+	--resume: continue the render saved in the checkpoint file instead of
+			  starting over.
+	--frame-budget=MS: show the window frame by frame, each frame within MS
+					   milliseconds, by computing parts of the image at a lower
+					   resolution and with fewer iterations first and refining
+					   them in later frames.
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param firstOption The index in argv of the first optional argument.
+@param options Pointer to where the options will be stored. Options that are
+not given keep their default values.
+@return An error code. 0 if operation was successful.
+*/
+int getOptions (int argc, char *argv[], int firstOption, RenderOptions *options);
+
+/**
+@fn pinThread
+@brief Pins the calling thread to one of the CPUs the process may run on.
+@param threadID The index of the calling thread among the worker threads.
+@param policy How threads are spread over the CPUs.
+@return true if the thread was pinned, false if pinning is not supported or
+failed.
+*/
+bool pinThread (int threadID, PinPolicy policy);
+
+/**
+@fn allocateBuffer
+@brief Allocates a zero-filled buffer for large images. The memory is not
+touched, so each page is placed near the thread that first writes to it, and
+large buffers are backed by huge pages where the system supports it.
+@param size The size of the buffer in bytes.
+@return The buffer, or NULL if it could not be allocated.
+*/
+void * allocateBuffer (size_t size);
+
+/**
+@fn freeBuffer
+@brief Frees a buffer allocated with allocateBuffer().
+@param buffer The buffer to free.
+@param size The size of the buffer in bytes, as passed to allocateBuffer().
+*/
+void freeBuffer (void *buffer, size_t size);
+
 /**
 @fn XTransform
 @brief Converts window coordinates (x = 0 is left of window) into complex
@@ -109,4 +397,73 @@ double YTransform (int y, double centerY, double planeHeight, long windowHeight)
 */
 int waitForClose ();
 
+/**
+@fn waitForCommand
+@brief Waits until the user closes the window or asks for a change to the
+image.
+@param point Pointer to where the pixel that was clicked will be stored for
+COMMAND_ZOOM_IN and COMMAND_ZOOM_OUT.
+@return The command given by the user (one of the COMMAND_ codes), or 
+COMMAND_ERROR if waiting failed.
+*/
+int waitForCommand (SDL_Point *point);
+
+/**
+@fn pollCommand
+@brief Handles the events that are waiting, without waiting for more.
+@param point Pointer to where the pixel that was clicked will be stored for
+COMMAND_ZOOM_IN and COMMAND_ZOOM_OUT.
+@return The first command given by the user (one of the COMMAND_ codes), or
+COMMAND_NONE if none of the waiting events was a command.
+*/
+int pollCommand (SDL_Point *point);
+
+/**
+@fn putU32
+@brief Stores a 32-bit number in little-endian byte order.
+@param bytes Where the number is stored.
+@param value The number.
+*/
+void putU32 (Uint8 *bytes, Uint32 value);
+
+/**
+@fn putU64
+@brief Stores a 64-bit number in little-endian byte order.
+@param bytes Where the number is stored.
+@param value The number.
+*/
+void putU64 (Uint8 *bytes, Uint64 value);
+
+/**
+@fn putDouble
+@brief Stores a double as the little-endian bytes of its bit pattern.
+@param bytes Where the number is stored.
+@param value The number.
+*/
+void putDouble (Uint8 *bytes, double value);
+
+/**
+@fn getU32
+@brief Reads a 32-bit number stored in little-endian byte order.
+@param bytes Where the number is stored.
+@return The number.
+*/
+Uint32 getU32 (const Uint8 *bytes);
+
+/**
+@fn getU64
+@brief Reads a 64-bit number stored in little-endian byte order.
+@param bytes Where the number is stored.
+@return The number.
+*/
+Uint64 getU64 (const Uint8 *bytes);
+
+/**
+@fn getDouble
+@brief Reads a double stored as the little-endian bytes of its bit pattern.
+@param bytes Where the number is stored.
+@return The number.
+*/
+double getDouble (const Uint8 *bytes);
+
 #endif /* HELPERFUNCTIONS_H */
\ No newline at end of file
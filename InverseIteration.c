@@ -0,0 +1,317 @@
+/**
+@file InverseIteration.c
+@author Rob Thomas
+@brief Contains a renderer that plots the boundary of a Julia set directly with
+the modified inverse iteration method (MIIM), and the choice between it and
+the escape-time renderer.
+*/
+
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "Drawing.h"
+#include "HelperFunctions.h"
+#include "JuliaSet.h"
+
+#include "InverseIteration.h"
+
+
+/**
+@fn mapDegree
+@brief Gives n for a map of the form f(z) = z^n + C.
+@param map The iteration map f(z).
+@return n, or 0 if the map is not of that form.
+*/
+static int mapDegree (JuliaMap map)
+{
+	if (map == MAP_QUADRATIC)
+	{
+		return 2;
+	}
+	if (map >= MAP_POWER3 && map <= MAP_POWER8)
+	{
+		return 3 + (map - MAP_POWER3);
+	}
+
+	return 0;
+}
+
+/**
+@fn repellingFixedPoint
+@brief Finds the most repelling fixed point of f(z) = z^n + C. The n fixed
+points are the roots of z^n - z + C, which are found all at once with the
+Durand-Kerner method. At most one of them attracts, so the one where |f'(z)|
+is largest repels and lies on the Julia set.
+@param degree n.
+@param C The complex constant of the map.
+@return The fixed point.
+*/
+static double complex repellingFixedPoint (int degree, double complex C)
+{
+	double complex roots[degree];
+
+	/* The usual starting points: powers of a number that is neither real nor
+	   a root of unity. */
+	for (int k = 0; k < degree; k++)
+	{
+		roots[k] = cpow(0.4 + 0.9 * I, k);
+	}
+
+	for (int step = 0; step < FIXED_POINT_STEPS; step++)
+	{
+		for (int k = 0; k < degree; k++)
+		{
+			double complex value = cpow(roots[k], degree) - roots[k] + C;
+			double complex product = 1.0;
+
+			for (int j = 0; j < degree; j++)
+			{
+				if (j != k)
+				{
+					product *= roots[k] - roots[j];
+				}
+			}
+
+			roots[k] -= value / product;
+		}
+	}
+
+	int best = 0;
+
+	for (int k = 1; k < degree; k++)
+	{
+		if (cabs(roots[k]) > cabs(roots[best]))
+		{
+			best = k;
+		}
+	}
+
+	return roots[best];
+}
+
+/**
+@fn inverseIterationSupports
+@brief Checks whether the inverse iteration renderer can draw a map. It needs
+the preimages of f, which are only computed for f(z) = z^n + C.
+@param map The iteration map f(z).
+@return true if the map is supported, false otherwise.
+*/
+bool inverseIterationSupports (JuliaMap map)
+{
+	return (mapDegree(map) != 0);
+}
+
+/**
+@fn chooseJuliaRenderer
+@brief Decides which renderer draws an image. RENDERER_AUTO picks inverse
+iteration when the Julia set is supported and disconnected (dust), which is
+when the orbit of the critical point 0 escapes, and escape time otherwise.
+@param requested The renderer that was asked for.
+@param params The image to draw.
+@return RENDERER_ESCAPE_TIME or RENDERER_INVERSE.
+*/
+JuliaRenderer chooseJuliaRenderer (JuliaRenderer requested, 
+								   const JuliaParams *params)
+{
+	if (requested != RENDERER_AUTO)
+	{
+		return requested;
+	}
+
+	int degree = mapDegree(params->map);
+
+	if (degree == 0 || params->coloring != COLOR_ESCAPE_TIME)
+	{
+		return RENDERER_ESCAPE_TIME;
+	}
+
+	/*** Follow the orbit of the critical point 0. The Julia set is
+		 connected exactly when it stays bounded. ***/
+	double radius = juliaEscapeRadius(params->map, params->C);
+	double complex z = 0.0;
+
+	for (int i = 0; i < CLASSIFY_ITERATIONS; i++)
+	{
+		double complex power = z;
+
+		for (int k = 1; k < degree; k++)
+		{
+			power *= z;
+		}
+
+		z = power + params->C;
+
+		if (distanceFromOrigin(z) > radius)
+		{
+			return RENDERER_INVERSE;
+		}
+	}
+
+	return RENDERER_ESCAPE_TIME;
+}
+
+/**
+@fn fillJuliaInverse
+@brief Draws the boundary of the Julia set described by params with the
+modified inverse iteration method. Backward orbits z -> (z - C)^(1/n) are
+traced depth-first from a point of the Julia set, and a point is only
+expanded into its n preimages while the pixel it falls on has been hit fewer
+than numIterations / MIIM_ITERATIONS_PER_HIT times. Pixels that were hit get
+the boundary color, all others the color of points outside of the set.
+@param params The Julia set image being computed. Its map must be supported
+(see inverseIterationSupports()).
+@param colorMap The 2-dimensional array of colors of the whole image.
+@return true if the image was drawn, false if memory ran out.
+*/
+bool fillJuliaInverse (const JuliaParams *params, SDL_Color **colorMap)
+{
+	long windowWidth = params->windowWidth;
+	long windowHeight = params->windowHeight;
+	int degree = mapDegree(params->map);
+	double cr = creal(params->C);
+	double ci = cimag(params->C);
+
+	int hitLimit = params->numIterations / MIIM_ITERATIONS_PER_HIT;
+
+	if (hitLimit < 1)
+	{
+		hitLimit = 1;
+	}
+	if (hitLimit > MIIM_MAX_HITS)
+	{
+		hitLimit = MIIM_MAX_HITS;
+	}
+
+	/*** Hits are counted per pixel inside the window, and per cell of a
+		 coarse grid over the square that holds the whole Julia set outside
+		 of it. Backward orbits have to pass outside of a zoomed-in window to
+		 come back into it, so they may not be cut off there. ***/
+	double left = params->centerX - params->planeWidth / 2.0;
+	double top = params->centerY + params->planeHeight / 2.0;
+	double radius = juliaEscapeRadius(params->map, params->C);
+	double cellSize = 2.0 * radius / MIIM_GRID_SIZE;
+
+	unsigned short *pixelHits = (unsigned short*)calloc(windowWidth * 
+														windowHeight,
+														sizeof(unsigned short));
+	unsigned short *cellHits = (unsigned short*)calloc(MIIM_GRID_SIZE * 
+													   MIIM_GRID_SIZE,
+													   sizeof(unsigned short));
+	long stackSize = 1024;
+	PreimagePoint *stack = (PreimagePoint*)malloc(sizeof(PreimagePoint) * 
+												  stackSize);
+
+	if (pixelHits == NULL || cellHits == NULL || stack == NULL)
+	{
+		free(pixelHits);
+		free(cellHits);
+		free(stack);
+
+		return false;
+	}
+
+	/*** Start from the most repelling fixed point, which lies on the Julia
+		 set. ***/
+	double complex seed = repellingFixedPoint(degree, params->C);
+
+	long numPoints = 1;
+
+	stack[0].zr = creal(seed);
+	stack[0].zi = cimag(seed);
+
+	/*** Trace the backward orbits depth-first. ***/
+	while (numPoints > 0)
+	{
+		PreimagePoint point = stack[--numPoints];
+		unsigned short *hits;
+
+		long x = (long)floor((point.zr - left) / params->planeWidth * 
+							 windowWidth);
+		long y = (long)floor((top - point.zi) / params->planeHeight * 
+							 windowHeight);
+
+		if (x >= 0 && x < windowWidth && y >= 0 && y < windowHeight)
+		{
+			hits = &pixelHits[x * windowHeight + y];
+		}
+		else
+		{
+			long column = (long)floor((point.zr + radius) / cellSize);
+			long row = (long)floor((radius - point.zi) / cellSize);
+
+			column = (column < 0) ? 0 : (column >= MIIM_GRID_SIZE) ? 
+					 MIIM_GRID_SIZE - 1 : column;
+			row = (row < 0) ? 0 : (row >= MIIM_GRID_SIZE) ? 
+				  MIIM_GRID_SIZE - 1 : row;
+
+			hits = &cellHits[column * MIIM_GRID_SIZE + row];
+		}
+
+		if (*hits >= hitLimit)
+		{
+			continue;
+		}
+
+		(*hits)++;
+
+		/* Push the n preimages (z - C)^(1/n) * e^(2 pi i k / n). */
+		if (numPoints + degree > stackSize)
+		{
+			stackSize *= 2;
+
+			PreimagePoint *bigger = (PreimagePoint*)realloc(stack,
+												sizeof(PreimagePoint) * 
+												stackSize);
+
+			if (bigger == NULL)
+			{
+				free(pixelHits);
+				free(cellHits);
+				free(stack);
+
+				return false;
+			}
+
+			stack = bigger;
+		}
+
+		double wr = point.zr - cr;
+		double wi = point.zi - ci;
+		double rootRadius = pow(sqrt(wr * wr + wi * wi), 1.0 / degree);
+		double angle = atan2(wi, wr) / degree;
+
+		for (int k = 0; k < degree; k++)
+		{
+			double rootAngle = angle + TWO_PI * k / degree;
+
+			stack[numPoints].zr = rootRadius * cos(rootAngle);
+			stack[numPoints].zi = rootRadius * sin(rootAngle);
+			numPoints++;
+		}
+	}
+
+	/*** Color the pixels that backward orbits hit as the boundary. ***/
+	double pixelSize = params->planeWidth / windowWidth;
+	SDL_Color boundary = colorFromDistance(0.0, pixelSize);
+	SDL_Color outside = colorFromDistance(BOUNDARY_WIDTH * pixelSize, 
+										  pixelSize);
+
+	for (long x = 0; x < windowWidth; x++)
+	{
+		for (long y = 0; y < windowHeight; y++)
+		{
+			colorMap[x][y] = pixelHits[x * windowHeight + y] ? boundary : 
+															   outside;
+		}
+	}
+
+	free(pixelHits);
+	free(cellHits);
+	free(stack);
+
+	return true;
+}
@@ -0,0 +1,109 @@
+/**
+@file InverseIteration.h
+@author Rob Thomas
+@brief Contains a renderer that plots the boundary of a Julia set directly with
+the modified inverse iteration method (MIIM), and the choice between it and
+the escape-time renderer.
+*/
+
+#ifndef INVERSEITERATION_H
+#define INVERSEITERATION_H
+
+#include <complex.h>
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "HelperFunctions.h"
+
+
+/**
+@def MIIM_ITERATIONS_PER_HIT
+@brief The number of iterations (of the escape-time renderer) that one allowed
+hit per pixel stands for. With the default number of iterations the backward
+orbits are continued from each pixel up to 4 times, and deepening the image
+doubles that.
+*/
+#define MIIM_ITERATIONS_PER_HIT 25
+
+/**
+@def MIIM_MAX_HITS
+@brief The most hits per pixel that are allowed, however deep the image is.
+*/
+#define MIIM_MAX_HITS 1024
+
+/**
+@def MIIM_GRID_SIZE
+@brief The number of cells along each side of the coarse grid that limits the
+hits of backward orbits outside of the window.
+*/
+#define MIIM_GRID_SIZE 512
+
+/**
+@def FIXED_POINT_STEPS
+@brief The number of Durand-Kerner steps taken to find the fixed points of the
+map, where the backward orbits start.
+*/
+#define FIXED_POINT_STEPS 100
+
+/**
+@def CLASSIFY_ITERATIONS
+@brief The number of iterations of the critical point after which C is taken
+to be in the connectedness locus (i.e. the Julia set to be connected).
+*/
+#define CLASSIFY_ITERATIONS 1000
+
+/**
+@def TWO_PI
+@brief The constant 2 pi, as math.h only defines M_PI outside of strict C99.
+*/
+#define TWO_PI 6.283185307179586
+
+
+/**
+@typedef PreimagePoint
+@brief The PreimagePoint struct is one point of a backward orbit that still
+has to be expanded into its preimages.
+*/
+typedef struct PreimagePoint
+{
+	double zr, zi;
+} PreimagePoint;
+
+
+/**
+@fn inverseIterationSupports
+@brief Checks whether the inverse iteration renderer can draw a map. It needs
+the preimages of f, which are only computed for f(z) = z^n + C.
+@param map The iteration map f(z).
+@return true if the map is supported, false otherwise.
+*/
+bool inverseIterationSupports (JuliaMap map);
+
+/**
+@fn chooseJuliaRenderer
+@brief Decides which renderer draws an image. RENDERER_AUTO picks inverse
+iteration when the Julia set is supported and disconnected (dust), which is
+when the orbit of the critical point 0 escapes, and escape time otherwise.
+@param requested The renderer that was asked for.
+@param params The image to draw.
+@return RENDERER_ESCAPE_TIME or RENDERER_INVERSE.
+*/
+JuliaRenderer chooseJuliaRenderer (JuliaRenderer requested, 
+								   const JuliaParams *params);
+
+/**
+@fn fillJuliaInverse
+@brief Draws the boundary of the Julia set described by params with the
+modified inverse iteration method. Backward orbits z -> (z - C)^(1/n) are
+traced depth-first from a point of the Julia set, and a point is only
+expanded into its n preimages while the pixel it falls on has been hit fewer
+than numIterations / MIIM_ITERATIONS_PER_HIT times. Pixels that were hit get
+the boundary color, all others the color of points outside of the set.
+@param params The Julia set image being computed. Its map must be supported
+(see inverseIterationSupports()).
+@param colorMap The 2-dimensional array of colors of the whole image.
+@return true if the image was drawn, false if memory ran out.
+*/
+bool fillJuliaInverse (const JuliaParams *params, SDL_Color **colorMap);
+
+#endif /* INVERSEITERATION_H */
@@ -0,0 +1,368 @@
+/**
+@file JuliaRender.c
+@author Rob Thomas
+@brief Contains the functions through which other programs render Julia set
+images straight into their own pixel buffers, without going through main().
+*/
+
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "Drawing.h"
+#include "HelperFunctions.h"
+#include "JuliaSet.h"
+
+#include "JuliaRender.h"
+
+
+/**
+@typedef JuliaContext
+@brief The JuliaContext struct holds a pool of worker threads and the render
+they are working on. A render is handed to the workers by increasing job and
+waking them up; each worker takes strips from nextTile and decreases
+busyThreads when none are left. renderLock lets one render run at a time.
+*/
+struct JuliaContext
+{
+	long numberOfThreads;
+	SDL_Thread **threads;
+	SDL_mutex *renderLock;
+	SDL_mutex *lock;
+	SDL_cond *wake;
+	SDL_cond *finished;
+	int job;
+	long busyThreads;
+	bool stopping;
+	JuliaParams params;
+	JuliaPixelFormat format;
+	Uint8 *pixels;
+	long stride;
+	long numTiles;
+	SDL_atomic_t nextTile;
+};
+
+
+/**
+@fn storePixel
+@brief Stores the color of a pixel in the caller's buffer.
+@param pixel Where the 4 bytes of the pixel go.
+@param color The color of the pixel.
+@param format How the pixel is stored. Not JULIA_FORMAT_COUNTS.
+*/
+static void storePixel (Uint8 *pixel, SDL_Color color, JuliaPixelFormat format)
+{
+	if (format == JULIA_FORMAT_BGRA32)
+	{
+		pixel[0] = color.b;
+		pixel[2] = color.r;
+	}
+	else
+	{
+		pixel[0] = color.r;
+		pixel[2] = color.b;
+	}
+
+	pixel[1] = color.g;
+	pixel[3] = color.a;
+}
+
+/**
+@fn renderTile
+@brief Renders the columns x0 to x1 - 1 of the image that a context is working
+on into the caller's buffer.
+@param context The render context.
+@param columns An array of params.windowWidth column pointers and room for
+the colors of JULIA_TILE_COLUMNS full columns, used for images colored by
+distance. May be NULL for the other images.
+@param x0 The first column of the strip.
+@param x1 One past the last column of the strip.
+*/
+static void renderTile (JuliaContext *context, SDL_Color **columns, long x0,
+						long x1)
+{
+	const JuliaParams *params = &context->params;
+	long height = params->windowHeight;
+
+	/*** Images colored by distance: render columns, then store them. ***/
+	if (params->coloring == COLOR_DISTANCE)
+	{
+		SDL_Color *colors = (SDL_Color*)(columns + params->windowWidth);
+
+		for (long x = x0; x < x1; x++)
+		{
+			columns[x] = colors + (x - x0) * height;
+		}
+
+		fillJuliaRegion(params, columns, NULL, x0, 0, x1, height);
+
+		for (long y = 0; y < height; y++)
+		{
+			Uint8 *row = context->pixels + y * context->stride;
+
+			for (long x = x0; x < x1; x++)
+			{
+				storePixel(row + x * 4, columns[x][y], context->format);
+			}
+		}
+
+		return;
+	}
+
+	/*** Other images: iteration counts in place, then their colors. ***/
+	fillJuliaCounts(params, (Sint32*)context->pixels + x0,
+					context->stride / (long)sizeof(Sint32), x0, 0, x1, height);
+
+	if (context->format == JULIA_FORMAT_COUNTS)
+	{
+		return;
+	}
+
+	for (long y = 0; y < height; y++)
+	{
+		Uint8 *row = context->pixels + y * context->stride;
+
+		for (long x = x0; x < x1; x++)
+		{
+			Sint32 stage = *(Sint32*)(row + x * 4);
+
+			storePixel(row + x * 4, (stage == JULIA_IN_SET) ? colorInSet() :
+					   colorOutOfSet(stage), context->format);
+		}
+	}
+}
+
+/**
+@fn juliaWorker
+@brief Works on the renders handed to a context until the context is freed.
+@param data A void pointer to be cast into a JuliaContext struct.
+*/
+static int juliaWorker (void *data)
+{
+	JuliaContext *context = (JuliaContext*)data;
+	int job = 0;
+
+	SDL_LockMutex(context->lock);
+
+	while (true)
+	{
+		while (context->job == job && !context->stopping)
+		{
+			SDL_CondWait(context->wake, context->lock);
+		}
+
+		if (context->stopping)
+		{
+			break;
+		}
+
+		job = context->job;
+		SDL_UnlockMutex(context->lock);
+
+		/* A worker that cannot get its memory leaves the strips to the
+		   others; renderJulia() notices if nobody took them. */
+		SDL_Color **columns = NULL;
+		bool ready = true;
+
+		if (context->params.coloring == COLOR_DISTANCE)
+		{
+			columns = (SDL_Color**)malloc(context->params.windowWidth *
+										  sizeof(SDL_Color*) +
+										  JULIA_TILE_COLUMNS *
+										  context->params.windowHeight *
+										  sizeof(SDL_Color));
+			ready = (columns != NULL);
+		}
+
+		while (ready)
+		{
+			long tile = SDL_AtomicAdd(&context->nextTile, 1);
+
+			if (tile >= context->numTiles)
+			{
+				break;
+			}
+
+			long x0 = tile * JULIA_TILE_COLUMNS;
+			long x1 = x0 + JULIA_TILE_COLUMNS;
+
+			renderTile(context, columns, x0,
+					   (x1 < context->params.windowWidth) ? x1 :
+					   context->params.windowWidth);
+		}
+
+		free(columns);
+
+		SDL_LockMutex(context->lock);
+
+		if (--context->busyThreads == 0)
+		{
+			SDL_CondSignal(context->finished);
+		}
+	}
+
+	SDL_UnlockMutex(context->lock);
+
+	return 0;
+}
+
+/**
+@fn newJuliaContext
+@brief Creates a render context and starts its worker threads.
+@param numberOfThreads The number of worker threads.
+@return The new context, or NULL if it could not be created.
+*/
+JuliaContext * newJuliaContext (long numberOfThreads)
+{
+	if (numberOfThreads < 1)
+	{
+		return NULL;
+	}
+
+	JuliaContext *context = (JuliaContext*)calloc(1, sizeof(JuliaContext));
+
+	if (context == NULL)
+	{
+		return NULL;
+	}
+
+	context->threads = (SDL_Thread**)calloc(numberOfThreads,
+											sizeof(SDL_Thread*));
+	context->renderLock = SDL_CreateMutex();
+	context->lock = SDL_CreateMutex();
+	context->wake = SDL_CreateCond();
+	context->finished = SDL_CreateCond();
+
+	if (context->threads == NULL || context->renderLock == NULL ||
+		context->lock == NULL || context->wake == NULL ||
+		context->finished == NULL)
+	{
+		freeJuliaContext(context);
+
+		return NULL;
+	}
+
+	for (long i = 0; i < numberOfThreads; i++)
+	{
+		context->threads[i] = SDL_CreateThread(juliaWorker, "Render Thread",
+											   (void*)context);
+
+		if (context->threads[i] == NULL)
+		{
+			freeJuliaContext(context);
+
+			return NULL;
+		}
+
+		context->numberOfThreads++;
+	}
+
+	return context;
+}
+
+/**
+@fn renderJulia
+@brief Renders an image into a buffer owned by the caller, using the worker
+threads of a context. Returns once the whole image has been written.
+@param context The render context.
+@param request The image to render.
+@param pixels The buffer. Pixel (x, y) is stored in the 4 bytes at
+pixels + y * stride + x * 4. It must be aligned to 4 bytes.
+@param stride The distance (in bytes) between two rows of the buffer: a
+multiple of 4 of at least request->width * 4.
+@return An error code. 0 if the image was rendered.
+*/
+int renderJulia (JuliaContext *context, const JuliaRequest *request,
+				 void *pixels, long stride)
+{
+	if (context == NULL || request == NULL || pixels == NULL ||
+		request->width < 1 || request->height < 1 ||
+		request->numIterations < 1 || request->map < 0 ||
+		request->map >= NUM_JULIA_MAPS || stride < request->width * 4 ||
+		stride % (long)sizeof(Sint32) != 0 ||
+		(uintptr_t)pixels % sizeof(Sint32) != 0 ||
+		(request->format == JULIA_FORMAT_COUNTS &&
+		 request->coloring != COLOR_ESCAPE_TIME))
+	{
+		return JULIA_REQUEST_FAIL;
+	}
+
+	SDL_LockMutex(context->renderLock);
+	SDL_LockMutex(context->lock);
+
+	/*** Hand the render to the workers. ***/
+	context->params.centerX = request->centerX;
+	context->params.centerY = request->centerY;
+	context->params.planeWidth = request->planeWidth;
+	context->params.planeHeight = request->planeHeight;
+	context->params.C = request->C;
+	context->params.windowWidth = request->width;
+	context->params.windowHeight = request->height;
+	context->params.numIterations = request->numIterations;
+	context->params.map = request->map;
+	context->params.coloring = request->coloring;
+	context->params.renderer = RENDERER_ESCAPE_TIME;
+	context->params.kernel = KERNEL_SCALAR;
+	context->format = request->format;
+	context->pixels = (Uint8*)pixels;
+	context->stride = stride;
+	context->numTiles = (request->width + JULIA_TILE_COLUMNS - 1) /
+						JULIA_TILE_COLUMNS;
+	SDL_AtomicSet(&context->nextTile, 0);
+	context->busyThreads = context->numberOfThreads;
+	context->job++;
+
+	SDL_CondBroadcast(context->wake);
+
+	/*** Wait for all of them to run out of strips. ***/
+	while (context->busyThreads > 0)
+	{
+		SDL_CondWait(context->finished, context->lock);
+	}
+
+	/* Every strip was taken unless no worker could get its memory. */
+	bool rendered = (SDL_AtomicGet(&context->nextTile) >= context->numTiles);
+
+	SDL_UnlockMutex(context->lock);
+	SDL_UnlockMutex(context->renderLock);
+
+	return rendered ? GET_ARGS_SUCCEED : JULIA_MEMORY_FAIL;
+}
+
+/**
+@fn freeJuliaContext
+@brief Stops the worker threads of a render context and frees it. No render
+may be running on the context.
+@param context The render context to be freed.
+*/
+void freeJuliaContext (JuliaContext *context)
+{
+	if (context == NULL)
+	{
+		return;
+	}
+
+	if (context->lock != NULL)
+	{
+		SDL_LockMutex(context->lock);
+		context->stopping = true;
+		SDL_CondBroadcast(context->wake);
+		SDL_UnlockMutex(context->lock);
+	}
+
+	for (long i = 0; i < context->numberOfThreads; i++)
+	{
+		SDL_WaitThread(context->threads[i], NULL);
+	}
+
+	free(context->threads);
+	SDL_DestroyMutex(context->renderLock);
+	SDL_DestroyMutex(context->lock);
+	SDL_DestroyCond(context->wake);
+	SDL_DestroyCond(context->finished);
+	free(context);
+}
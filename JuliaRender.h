@@ -0,0 +1,122 @@
+/**
+@file JuliaRender.h
+@author Rob Thomas
+@brief Contains the functions through which other programs render Julia set
+images straight into their own pixel buffers, without going through main().
+@details A render context owns a pool of worker threads that sleep between
+renders. Each render is described by a JuliaRequest and written into a buffer
+owned by the caller, whose rows may be padded (stride). The image is split
+into strips of JULIA_TILE_COLUMNS columns, and the workers take strips until
+none are left. Every pixel format is 4 bytes per pixel, so an image colored by
+escape time is computed as iteration counts directly in the caller's buffer
+and then colored in place; nothing is copied. Contexts share no state, so
+several of them may render at the same time from different threads, and
+renders on the same context simply take turns.
+
+The library is built from this file and the computing core (JuliaSet.c,
+InverseIteration.c, Drawing.c, HelperFunctions.c and TileQueue.c) by the
+libjulia.a and libjulia.so targets of the makefile. Programs using it only
+need this header and JuliaTypes.h, and link against SDL2.
+*/
+
+#ifndef JULIARENDER_H
+#define JULIARENDER_H
+
+#include <complex.h>
+
+#include "JuliaTypes.h"
+
+
+/**
+@def JULIA_REQUEST_FAIL
+@brief Error code indicating that a render request or its output buffer is
+invalid.
+*/
+#define JULIA_REQUEST_FAIL 14
+
+/**
+@def JULIA_MEMORY_FAIL
+@brief Error code indicating that a render could not get the memory it needed.
+*/
+#define JULIA_MEMORY_FAIL 15
+
+/**
+@def JULIA_TILE_COLUMNS
+@brief The number of columns of the image that a worker thread takes at once.
+16 pixels of 4 bytes are one cache line, so no two threads write to the same
+line of an aligned buffer.
+*/
+#define JULIA_TILE_COLUMNS 16
+
+
+/**
+@typedef JuliaPixelFormat
+@brief Identifies how the pixels of a rendered image are stored in the
+caller's buffer. Every format takes 4 bytes per pixel.
+*/
+typedef enum JuliaPixelFormat
+{
+	JULIA_FORMAT_RGBA32,	/* Bytes red, green, blue, alpha. */
+	JULIA_FORMAT_BGRA32,	/* Bytes blue, green, red, alpha. */
+	JULIA_FORMAT_COUNTS		/* Signed 32-bit escape stage, or JULIA_IN_SET. */
+} JuliaPixelFormat;
+
+/**
+@typedef JuliaRequest
+@brief The JuliaRequest struct describes one image to be rendered: the
+constant C, the slice of the complex plane it shows, its size in pixels, the
+iteration limit, the map being iterated, how it is colored and how its pixels
+are stored. Images in JULIA_FORMAT_COUNTS are never colored, so coloring must
+be COLOR_ESCAPE_TIME for them.
+*/
+typedef struct JuliaRequest
+{
+	double complex C;
+	double centerX, centerY, planeWidth, planeHeight;
+	long width, height;
+	int numIterations;
+	JuliaMap map;
+	ColoringMode coloring;
+	JuliaPixelFormat format;
+} JuliaRequest;
+
+/**
+@typedef JuliaContext
+@brief A render context: a pool of worker threads and the render they are
+working on. Its fields are private to JuliaRender.c.
+*/
+typedef struct JuliaContext JuliaContext;
+
+
+/**
+@fn newJuliaContext
+@brief Creates a render context and starts its worker threads.
+@param numberOfThreads The number of worker threads.
+@return The new context, or NULL if it could not be created.
+*/
+JuliaContext * newJuliaContext (long numberOfThreads);
+
+/**
+@fn renderJulia
+@brief Renders an image into a buffer owned by the caller, using the worker
+threads of a context. Returns once the whole image has been written.
+@param context The render context.
+@param request The image to render.
+@param pixels The buffer. Pixel (x, y) is stored in the 4 bytes at
+pixels + y * stride + x * 4. It must be aligned to 4 bytes.
+@param stride The distance (in bytes) between two rows of the buffer: a
+multiple of 4 of at least request->width * 4.
+@return An error code. 0 if the image was rendered.
+*/
+int renderJulia (JuliaContext *context, const JuliaRequest *request,
+				 void *pixels, long stride);
+
+/**
+@fn freeJuliaContext
+@brief Stops the worker threads of a render context and frees it. No render
+may be running on the context.
+@param context The render context to be freed.
+*/
+void freeJuliaContext (JuliaContext *context);
+
+#endif /* JULIARENDER_H */
@@ -10,9 +10,12 @@ the complex plane.
 #include <stdbool.h>
 #include <SDL2/SDL.h>
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "Drawing.h"
 #include "HelperFunctions.h"
+#include "InverseIteration.h"
 
 #include "JuliaSet.h"
 
@@ -53,15 +56,834 @@ int partialFill (void *data)
 	/* Retrieve the data passed from SDL_CreateThread. */
 	ThreadData *d = (ThreadData*)data;
 
-	/* Call fillJuliaSet with the data passed in. */
-	fillJuliaSet (d->centerX, d->centerY, d->planeWidth, 
-				   d->planeHeight, d->windowWidth, d->windowHeight, 
-				   d->numIterations, *(d->colorMapPtr), d->C,
-				   d->numberOfThreads, d->threadID);
+	/* Pin the thread first, so that the pages of its chunks are placed on
+	   its own socket when it first writes to them. */
+	if (d->pinning != PIN_NONE)
+	{
+		pinThread(d->threadID, d->pinning);
+	}
+
+	long chunk = d->chunkColumns;
+	long windowWidth = d->params.windowWidth;
+
+	/* Inverse iteration traces the whole image at once, so the first thread
+	   does all of it and then reports every chunk as finished. */
+	if (d->params.renderer == RENDERER_INVERSE)
+	{
+		if (d->threadID != 0)
+		{
+			return 0;
+		}
+
+		fillJuliaInverse(&d->params, *(d->colorMapPtr));
+
+		for (long x0 = 0; d->tiles != NULL && x0 < windowWidth; x0 += chunk)
+		{
+			Tile tile = {x0, 0, (x0 + chunk < windowWidth) ? x0 + chunk : 
+						 windowWidth, d->params.windowHeight};
+
+			pushTile(d->tiles, tile);
+		}
+
+		return 0;
+	}
+
+	/* Fill this thread's chunks of columns with the data passed in. */
+
+	for (long x0 = d->threadID * chunk; x0 < windowWidth;
+		 x0 += d->numberOfThreads * chunk)
+	{
+		long x1 = (x0 + chunk < windowWidth) ? x0 + chunk : windowWidth;
+		bool computed = false;
+
+		/* Go column by column, so that a newer render can cancel this one
+		   within about one column's worth of work. */
+		for (long x = x0; x < x1; x++)
+		{
+			if (d->generation != NULL && 
+				SDL_AtomicGet(d->generation) != d->renderGeneration)
+			{
+				return 0;
+			}
+			if (d->finishedColumns != NULL && d->finishedColumns[x])
+			{
+				continue;
+			}
+
+			fillJuliaRegion(&d->params, *(d->colorMapPtr), *(d->orbitMapPtr),
+							x, 0, x + 1, d->params.windowHeight);
+			computed = true;
+		}
+
+		/* Report the chunk so that it can be shown (or saved) right away. */
+		if (d->tiles != NULL && computed)
+		{
+			Tile tile = {x0, 0, x1, d->params.windowHeight};
+
+			pushTile(d->tiles, tile);
+		}
+	}
 
 	return 0;
 }
 
+/*** Iteration kernels. ***/
+
+/* Each STEP macro replaces (zr, zi) with f(zr + zi*i) for one iteration map,
+   written out in real arithmetic so that the compiler can keep the whole orbit
+   in registers. T is the type of the temporaries: double, or LaneDouble when
+   the step is applied to every lane of a vector at once. */
+
+#define QUADRATIC_STEP(T, zr, zi, cr, ci)									\
+{																			\
+	T sqR = zr * zr - zi * zi;												\
+	zi = 2.0 * zr * zi + ci;												\
+	zr = sqR + cr;															\
+}
+
+/* Multiplies (ar + ai*i) by (br + bi*i) into new variables (outR + outI*i). */
+#define COMPLEX_MUL(T, outR, outI, ar, ai, br, bi)							\
+	T outR = ar * br - ai * bi;												\
+	T outI = ar * bi + ai * br;
+
+#define POWER3_STEP(T, zr, zi, cr, ci)										\
+{																			\
+	COMPLEX_MUL(T, z2r, z2i, zr, zi, zr, zi)								\
+	COMPLEX_MUL(T, z3r, z3i, z2r, z2i, zr, zi)								\
+	zr = z3r + cr;															\
+	zi = z3i + ci;															\
+}
+
+#define POWER4_STEP(T, zr, zi, cr, ci)										\
+{																			\
+	COMPLEX_MUL(T, z2r, z2i, zr, zi, zr, zi)								\
+	COMPLEX_MUL(T, z4r, z4i, z2r, z2i, z2r, z2i)							\
+	zr = z4r + cr;															\
+	zi = z4i + ci;															\
+}
+
+#define POWER5_STEP(T, zr, zi, cr, ci)										\
+{																			\
+	COMPLEX_MUL(T, z2r, z2i, zr, zi, zr, zi)								\
+	COMPLEX_MUL(T, z4r, z4i, z2r, z2i, z2r, z2i)							\
+	COMPLEX_MUL(T, z5r, z5i, z4r, z4i, zr, zi)								\
+	zr = z5r + cr;															\
+	zi = z5i + ci;															\
+}
+
+#define POWER6_STEP(T, zr, zi, cr, ci)										\
+{																			\
+	COMPLEX_MUL(T, z2r, z2i, zr, zi, zr, zi)								\
+	COMPLEX_MUL(T, z4r, z4i, z2r, z2i, z2r, z2i)							\
+	COMPLEX_MUL(T, z6r, z6i, z4r, z4i, z2r, z2i)							\
+	zr = z6r + cr;															\
+	zi = z6i + ci;															\
+}
+
+#define POWER7_STEP(T, zr, zi, cr, ci)										\
+{																			\
+	COMPLEX_MUL(T, z2r, z2i, zr, zi, zr, zi)								\
+	COMPLEX_MUL(T, z3r, z3i, z2r, z2i, zr, zi)								\
+	COMPLEX_MUL(T, z4r, z4i, z2r, z2i, z2r, z2i)							\
+	COMPLEX_MUL(T, z7r, z7i, z4r, z4i, z3r, z3i)							\
+	zr = z7r + cr;															\
+	zi = z7i + ci;															\
+}
+
+#define POWER8_STEP(T, zr, zi, cr, ci)										\
+{																			\
+	COMPLEX_MUL(T, z2r, z2i, zr, zi, zr, zi)								\
+	COMPLEX_MUL(T, z4r, z4i, z2r, z2i, z2r, z2i)							\
+	COMPLEX_MUL(T, z8r, z8i, z4r, z4i, z4r, z4i)							\
+	zr = z8r + cr;															\
+	zi = z8i + ci;															\
+}
+
+#define BURNING_SHIP_STEP(T, zr, zi, cr, ci)								\
+{																			\
+	T absR = fabs(zr);														\
+	T absI = fabs(zi);														\
+	T sqR = absR * absR - absI * absI;										\
+	zi = 2.0 * absR * absI + ci;											\
+	zr = sqR + cr;															\
+}
+
+#define CUBIC_STEP(T, zr, zi, cr, ci)										\
+{																			\
+	COMPLEX_MUL(T, z2r, z2i, zr, zi, zr, zi)								\
+	COMPLEX_MUL(T, z3r, z3i, z2r, z2i, zr, zi)								\
+	zr = z3r - zr + cr;														\
+	zi = z3i - zi + ci;														\
+}
+
+/* Each DERIV macro replaces (dr, di) with f'(z) * (dr + di*i), the derivative
+   of the orbit with respect to its starting point, for the z before the STEP
+   of the same iteration is applied. */
+
+/* Multiplies (dr + di*i) by n * (zr + zi*i)^(n - 1). */
+#define POWER_DERIV(n, zr, zi, dr, di)										\
+{																			\
+	double wr = n * zr;														\
+	double wi = n * zi;														\
+																			\
+	for (int k = 2; k < n; k++)												\
+	{																		\
+		double t = wr * zr - wi * zi;										\
+		wi = wr * zi + wi * zr;												\
+		wr = t;																\
+	}																		\
+																			\
+	double nextR = wr * dr - wi * di;										\
+	di = wr * di + wi * dr;													\
+	dr = nextR;																\
+}
+
+#define QUADRATIC_DERIV(zr, zi, dr, di)	POWER_DERIV(2, zr, zi, dr, di)
+#define POWER3_DERIV(zr, zi, dr, di)	POWER_DERIV(3, zr, zi, dr, di)
+#define POWER4_DERIV(zr, zi, dr, di)	POWER_DERIV(4, zr, zi, dr, di)
+#define POWER5_DERIV(zr, zi, dr, di)	POWER_DERIV(5, zr, zi, dr, di)
+#define POWER6_DERIV(zr, zi, dr, di)	POWER_DERIV(6, zr, zi, dr, di)
+#define POWER7_DERIV(zr, zi, dr, di)	POWER_DERIV(7, zr, zi, dr, di)
+#define POWER8_DERIV(zr, zi, dr, di)	POWER_DERIV(8, zr, zi, dr, di)
+
+/* The burning ship map is not analytic; the usual estimate treats it as z^2
+   applied to the folded point. */
+#define BURNING_SHIP_DERIV(zr, zi, dr, di)									\
+{																			\
+	double foldR = fabs(zr);												\
+	double foldI = fabs(zi);												\
+																			\
+	POWER_DERIV(2, foldR, foldI, dr, di)									\
+}
+
+#define CUBIC_DERIV(zr, zi, dr, di)											\
+{																			\
+	double wr = 3.0 * (zr * zr - zi * zi) - 1.0;							\
+	double wi = 6.0 * zr * zi;												\
+	double nextR = wr * dr - wi * di;										\
+	di = wr * di + wi * dr;													\
+	dr = nextR;																\
+}
+
+/* The table of iteration maps: enum value, kernel name, command line name,
+   base escape radius, STEP and DERIV macros and the kind of lane kernel it gets
+   (VECTOR if STEP only uses arithmetic, which works on vectors too, SCALAR if
+   not).
+   The base escape radius R of a map is the smallest radius for which
+   |z| > max(R, |C|) guarantees |f(z)| > |z|. */
+#define JULIA_MAPS(X)														\
+	X(MAP_QUADRATIC,	Quadratic,		"z2",			2.0,				\
+	  QUADRATIC_STEP, QUADRATIC_DERIV, VECTOR)								\
+	X(MAP_POWER3,		Power3,			"z3",			1.4142135623730951,	\
+	  POWER3_STEP, POWER3_DERIV, VECTOR)									\
+	X(MAP_POWER4,		Power4,			"z4",			1.2599210498948732,	\
+	  POWER4_STEP, POWER4_DERIV, VECTOR)									\
+	X(MAP_POWER5,		Power5,			"z5",			1.1892071150027210,	\
+	  POWER5_STEP, POWER5_DERIV, VECTOR)									\
+	X(MAP_POWER6,		Power6,			"z6",			1.1486983549970351,	\
+	  POWER6_STEP, POWER6_DERIV, VECTOR)									\
+	X(MAP_POWER7,		Power7,			"z7",			1.1224620483093730,	\
+	  POWER7_STEP, POWER7_DERIV, VECTOR)									\
+	X(MAP_POWER8,		Power8,			"z8",			1.1040895136738123,	\
+	  POWER8_STEP, POWER8_DERIV, VECTOR)									\
+	X(MAP_BURNING_SHIP, BurningShip,	"burningship",	2.0,				\
+	  BURNING_SHIP_STEP, BURNING_SHIP_DERIV, SCALAR)						\
+	X(MAP_CUBIC,		Cubic,			"cubic",		1.7320508075688772,	\
+	  CUBIC_STEP, CUBIC_DERIV, VECTOR)
+
+/* Defines, for one map, the kernel resume<name>() that continues an orbit
+   from iteration start to numIterations and returns the stage at which it
+   escaped, ORBIT_SETTLED if it reached a fixed point or ORBIT_BOUNDED if it
+   is still bounded, leaving the last z in (zr, zi). iterate<name>() runs a
+   whole orbit with it and returns the stage or JULIA_IN_SET. fill<name>()
+   fills the columns x0, x0 + xStep, ... below x1 and rows y0 to y1 - 1 of a
+   color map with that kernel, fill<name>Counts() stores the stages of a
+   rectangle in a row-major array instead, fill<name>Points() stores the
+   stages of a list of arbitrary points, and fill<name>Resume() fills a
+   color map while continuing the orbits kept in an orbit map. The kernel is
+   inlined into the fill loops, so the choice of map costs nothing per
+   iteration. */
+#define DEFINE_JULIA_KERNEL(mapID, name, label, radius, STEP, DERIV, lanes)	\
+static inline int resume##name (double *zrPtr, double *ziPtr, double cr,	\
+								double ci, int start, int numIterations,	\
+								double escapeRadiusSq)						\
+{																			\
+	double zr = *zrPtr;														\
+	double zi = *ziPtr;														\
+	int stage = ORBIT_BOUNDED;												\
+																			\
+	for (int i = start; i < numIterations; i++)								\
+	{																		\
+		double prevR = zr;													\
+		double prevI = zi;													\
+																			\
+		STEP(double, zr, zi, cr, ci)										\
+																			\
+		if (zr * zr + zi * zi > escapeRadiusSq)								\
+		{																	\
+			stage = i;														\
+			break;															\
+		}																	\
+		/* A fixed point can never escape. */								\
+		if (zr == prevR && zi == prevI)										\
+		{																	\
+			stage = ORBIT_SETTLED;											\
+			break;															\
+		}																	\
+	}																		\
+																			\
+	*zrPtr = zr;															\
+	*ziPtr = zi;															\
+																			\
+	return stage;															\
+}																			\
+																			\
+static inline int iterate##name (double zr, double zi, double cr,			\
+								 double ci, int numIterations,				\
+								 double escapeRadiusSq)						\
+{																			\
+	int stage = resume##name(&zr, &zi, cr, ci, 0, numIterations,			\
+							 escapeRadiusSq);								\
+																			\
+	return (stage >= 0) ? stage : JULIA_IN_SET;								\
+}																			\
+																			\
+static void fill##name (const JuliaParams *p, SDL_Color **colorMap,			\
+						long x0, long x1, long xStep, long y0, long y1,		\
+						double escapeRadiusSq)								\
+{																			\
+	double cr = creal(p->C);												\
+	double ci = cimag(p->C);												\
+																			\
+	for (long x = x0; x < x1; x += xStep)									\
+	{																		\
+		double compX = XTransform(x, p->centerX, p->planeWidth,				\
+								  p->windowWidth);							\
+																			\
+		for (long y = y0; y < y1; y++)										\
+		{																	\
+			double compY = YTransform(y, p->centerY, p->planeHeight,		\
+									  p->windowHeight);						\
+			int stage = iterate##name(compX, compY, cr, ci,					\
+									  p->numIterations, escapeRadiusSq);	\
+																			\
+			colorMap[x][y] = (stage == JULIA_IN_SET) ? colorInSet() :		\
+							 colorOutOfSet(stage);							\
+		}																	\
+	}																		\
+}																			\
+																			\
+static void fill##name##Counts (const JuliaParams *p, Sint32 *counts,		\
+								long stride, long x0, long y0, long x1,		\
+								long y1, double escapeRadiusSq)				\
+{																			\
+	double cr = creal(p->C);												\
+	double ci = cimag(p->C);												\
+																			\
+	for (long y = y0; y < y1; y++)											\
+	{																		\
+		double compY = YTransform(y, p->centerY, p->planeHeight,			\
+								  p->windowHeight);							\
+		Sint32 *row = counts + (y - y0) * stride;							\
+																			\
+		for (long x = x0; x < x1; x++)										\
+		{																	\
+			double compX = XTransform(x, p->centerX, p->planeWidth,			\
+									  p->windowWidth);						\
+																			\
+			row[x - x0] = iterate##name(compX, compY, cr, ci,				\
+										p->numIterations, escapeRadiusSq);	\
+		}																	\
+	}																		\
+}																			\
+																			\
+static void fill##name##Points (const JuliaParams *p, const double *re,		\
+								const double *im, long numPoints,			\
+								Sint32 *counts, double escapeRadiusSq)		\
+{																			\
+	double cr = creal(p->C);												\
+	double ci = cimag(p->C);												\
+																			\
+	for (long i = 0; i < numPoints; i++)									\
+	{																		\
+		counts[i] = iterate##name(re[i], im[i], cr, ci, p->numIterations,	\
+								  escapeRadiusSq);							\
+	}																		\
+}																			\
+																			\
+static void fill##name##Resume (const JuliaParams *p, SDL_Color **colorMap,	\
+								OrbitState **orbitMap, long x0, long x1,	\
+								long xStep, long y0, long y1,				\
+								double escapeRadiusSq)						\
+{																			\
+	double cr = creal(p->C);												\
+	double ci = cimag(p->C);												\
+																			\
+	for (long x = x0; x < x1; x += xStep)									\
+	{																		\
+		for (long y = y0; y < y1; y++)										\
+		{																	\
+			OrbitState *orbit = &orbitMap[x][y];							\
+																			\
+			/* Only orbits that were still bounded at the last limit need	\
+			   any more work. */											\
+			if (orbit->iterations == 0 ||									\
+				(orbit->stage == ORBIT_BOUNDED &&							\
+				 orbit->iterations < p->numIterations))						\
+			{																\
+				if (orbit->iterations == 0)									\
+				{															\
+					orbit->zr = XTransform(x, p->centerX, p->planeWidth,	\
+										   p->windowWidth);					\
+					orbit->zi = YTransform(y, p->centerY, p->planeHeight,	\
+										   p->windowHeight);				\
+				}															\
+																			\
+				orbit->stage = resume##name(&orbit->zr, &orbit->zi, cr, ci,	\
+											orbit->iterations,				\
+											p->numIterations,				\
+											escapeRadiusSq);				\
+				orbit->iterations = p->numIterations;						\
+			}																\
+																			\
+			colorMap[x][y] = (orbit->stage >= 0) ?							\
+							 colorOutOfSet(orbit->stage) : colorInSet();	\
+		}																	\
+	}																		\
+}
+
+JULIA_MAPS(DEFINE_JULIA_KERNEL)
+
+/* Defines, for one map, the kernel distance<name>() that also follows the
+   derivative dz of the orbit and returns the exterior distance estimate
+   |z| log|z| / |dz| of a point that escaped (or -1 for a point in the set),
+   and fill<name>Distance() that colors a region of a color map by it. The
+   estimate needs |z| to be large when the orbit stops, so the orbit is only
+   stopped once it passes DISTANCE_ESCAPE_RADIUS. */
+#define DEFINE_JULIA_DISTANCE_KERNEL(mapID, name, label, radius, STEP,		\
+									 DERIV, lanes)							\
+static inline double distance##name (double zr, double zi, double cr,		\
+									 double ci, int numIterations,			\
+									 double escapeRadiusSq)					\
+{																			\
+	double dr = 1.0;														\
+	double di = 0.0;														\
+																			\
+	for (int i = 0; i < numIterations; i++)									\
+	{																		\
+		double prevR = zr;													\
+		double prevI = zi;													\
+																			\
+		DERIV(zr, zi, dr, di)												\
+		STEP(double, zr, zi, cr, ci)										\
+																			\
+		double distanceSq = zr * zr + zi * zi;								\
+																			\
+		if (distanceSq > escapeRadiusSq)									\
+		{																	\
+			double distance = sqrt(distanceSq);								\
+																			\
+			return distance * log(distance) / sqrt(dr * dr + di * di);		\
+		}																	\
+		if (zr == prevR && zi == prevI)										\
+		{																	\
+			return -1.0;													\
+		}																	\
+	}																		\
+																			\
+	return -1.0;															\
+}																			\
+																			\
+static void fill##name##Distance (const JuliaParams *p,						\
+								  SDL_Color **colorMap, long x0, long x1,	\
+								  long xStep, long y0, long y1,				\
+								  double escapeRadiusSq)					\
+{																			\
+	double cr = creal(p->C);												\
+	double ci = cimag(p->C);												\
+	double pixelSize = p->planeWidth / p->windowWidth;						\
+																			\
+	if (escapeRadiusSq < DISTANCE_ESCAPE_RADIUS * DISTANCE_ESCAPE_RADIUS)	\
+	{																		\
+		escapeRadiusSq = DISTANCE_ESCAPE_RADIUS * DISTANCE_ESCAPE_RADIUS;	\
+	}																		\
+																			\
+	for (long x = x0; x < x1; x += xStep)									\
+	{																		\
+		double compX = XTransform(x, p->centerX, p->planeWidth,				\
+								  p->windowWidth);							\
+																			\
+		for (long y = y0; y < y1; y++)										\
+		{																	\
+			double compY = YTransform(y, p->centerY, p->planeHeight,		\
+									  p->windowHeight);						\
+			double distance = distance##name(compX, compY, cr, ci,			\
+											 p->numIterations,				\
+											 escapeRadiusSq);				\
+																			\
+			colorMap[x][y] = colorFromDistance(distance, pixelSize);		\
+		}																	\
+	}																		\
+}
+
+JULIA_MAPS(DEFINE_JULIA_DISTANCE_KERNEL)
+
+/* Defines, for one map, fill<name>Lanes() that fills the same region of
+   JULIA_LANES images at once, where lane k carries the C of image k. When the
+   compiler offers vector types wide enough for every lane (GCC or Clang
+   targeting AVX2), maps with a VECTOR lane kernel run all lanes in one vector;
+   a lane that is done keeps iterating without effect until every lane is done.
+   Otherwise each lane runs the scalar kernel in turn. */
+#if defined(__GNUC__)
+
+typedef double LaneDouble __attribute__((vector_size(JULIA_LANES * 
+														 sizeof(double))));
+typedef long long LaneMask __attribute__((vector_size(JULIA_LANES * 
+													   sizeof(long long))));
+
+#endif
+
+#if defined(__GNUC__) && defined(__AVX2__)
+
+#define DEFINE_JULIA_LANE_KERNEL_VECTOR(name, STEP)							\
+static void fill##name##Lanes (const JuliaParams *p, const double *cr,		\
+							   const double *ci,							\
+							   const double *escapeRadiusSq,				\
+							   SDL_Color **colorMap, const long *xOffset,	\
+							   const long *yOffset, long x0, long y0,		\
+							   long x1, long y1)							\
+{																			\
+	LaneDouble laneCR, laneCI, laneRadiusSq;								\
+																			\
+	for (int lane = 0; lane < JULIA_LANES; lane++)							\
+	{																		\
+		laneCR[lane] = cr[lane];											\
+		laneCI[lane] = ci[lane];											\
+		laneRadiusSq[lane] = escapeRadiusSq[lane];							\
+	}																		\
+																			\
+	for (long x = x0; x < x1; x++)											\
+	{																		\
+		double compX = XTransform(x, p->centerX, p->planeWidth,				\
+								  p->windowWidth);							\
+																			\
+		for (long y = y0; y < y1; y++)										\
+		{																	\
+			double compY = YTransform(y, p->centerY, p->planeHeight,		\
+									  p->windowHeight);						\
+			LaneDouble zr = (LaneDouble){0} + compX;						\
+			LaneDouble zi = (LaneDouble){0} + compY;						\
+			LaneMask running = (LaneMask){0} - 1;							\
+			LaneMask stages = (LaneMask){0} + JULIA_IN_SET;					\
+																			\
+			for (int i = 0; i < p->numIterations; i++)						\
+			{																\
+				LaneDouble prevR = zr;										\
+				LaneDouble prevI = zi;										\
+																			\
+				STEP(LaneDouble, zr, zi, laneCR, laneCI)					\
+																			\
+				LaneMask escaped = (zr * zr + zi * zi > laneRadiusSq);		\
+				LaneMask fixed = (zr == prevR) & (zi == prevI);				\
+				LaneMask stopped = running & escaped;						\
+																			\
+				stages = (stages & ~stopped) | (((LaneMask){0} + i) &		\
+												stopped);					\
+				running &= ~(escaped | fixed);								\
+																			\
+				long long anyRunning = 0;									\
+																			\
+				for (int lane = 0; lane < JULIA_LANES; lane++)				\
+				{															\
+					anyRunning |= running[lane];							\
+				}															\
+				if (!anyRunning)											\
+				{															\
+					break;													\
+				}															\
+			}																\
+																			\
+			for (int lane = 0; lane < JULIA_LANES; lane++)					\
+			{																\
+				if (xOffset[lane] >= 0)										\
+				{															\
+					int stage = (int)stages[lane];							\
+																			\
+					colorMap[xOffset[lane] + x][yOffset[lane] + y] =		\
+						(stage == JULIA_IN_SET) ? colorInSet() :			\
+						colorOutOfSet(stage);								\
+				}															\
+			}																\
+		}																	\
+	}																		\
+}
+
+#else
+
+#define DEFINE_JULIA_LANE_KERNEL_VECTOR(name, STEP)							\
+	DEFINE_JULIA_LANE_KERNEL_SCALAR(name, STEP)
+
+#endif
+
+#define DEFINE_JULIA_LANE_KERNEL_SCALAR(name, STEP)							\
+static void fill##name##Lanes (const JuliaParams *p, const double *cr,		\
+							   const double *ci,							\
+							   const double *escapeRadiusSq,				\
+							   SDL_Color **colorMap, const long *xOffset,	\
+							   const long *yOffset, long x0, long y0,		\
+							   long x1, long y1)							\
+{																			\
+	for (int lane = 0; lane < JULIA_LANES; lane++)							\
+	{																		\
+		if (xOffset[lane] < 0)												\
+		{																	\
+			continue;														\
+		}																	\
+																			\
+		for (long x = x0; x < x1; x++)										\
+		{																	\
+			double compX = XTransform(x, p->centerX, p->planeWidth,			\
+									  p->windowWidth);						\
+																			\
+			for (long y = y0; y < y1; y++)									\
+			{																\
+				double compY = YTransform(y, p->centerY, p->planeHeight,	\
+										  p->windowHeight);					\
+				int stage = iterate##name(compX, compY, cr[lane], ci[lane],	\
+										  p->numIterations,					\
+										  escapeRadiusSq[lane]);			\
+																			\
+				colorMap[xOffset[lane] + x][yOffset[lane] + y] =			\
+					(stage == JULIA_IN_SET) ? colorInSet() :				\
+					colorOutOfSet(stage);									\
+			}																\
+		}																	\
+	}																		\
+}
+
+#define DEFINE_JULIA_LANE_KERNEL(mapID, name, label, radius, STEP, DERIV, lanes) \
+	DEFINE_JULIA_LANE_KERNEL_##lanes(name, STEP)
+
+JULIA_MAPS(DEFINE_JULIA_LANE_KERNEL)
+
+/* Defines, for one map, fill<name>Vector() that fills a region of a color map
+   like fill<name>() but iterates JULIA_LANES rows of a column side by side,
+   one per vector lane. Unlike fill<name>Lanes(), it is built for whatever
+   vectors the target has, since only timing it shows whether it beats the
+   scalar kernel on a given machine (see Autotune.h). Maps with a SCALAR lane
+   kernel, and compilers without vector types, use fill<name>() instead. */
+#if defined(__GNUC__)
+
+#define DEFINE_JULIA_VECTOR_KERNEL_VECTOR(name, STEP)						\
+static void fill##name##Vector (const JuliaParams *p, SDL_Color **colorMap,	\
+								long x0, long x1, long xStep, long y0,		\
+								long y1, double escapeRadiusSq)				\
+{																			\
+	LaneDouble cr = (LaneDouble){0} + creal(p->C);							\
+	LaneDouble ci = (LaneDouble){0} + cimag(p->C);							\
+	LaneDouble radiusSq = (LaneDouble){0} + escapeRadiusSq;					\
+																			\
+	for (long x = x0; x < x1; x += xStep)									\
+	{																		\
+		double compX = XTransform(x, p->centerX, p->planeWidth,				\
+								  p->windowWidth);							\
+																			\
+		for (long y = y0; y < y1; y += JULIA_LANES)							\
+		{																	\
+			LaneDouble zr = (LaneDouble){0} + compX;						\
+			LaneDouble zi;													\
+			LaneMask running = (LaneMask){0} - 1;							\
+			LaneMask stages = (LaneMask){0} + JULIA_IN_SET;					\
+																			\
+			/* Lanes below the last row follow points that are not			\
+			   stored. */													\
+			for (int lane = 0; lane < JULIA_LANES; lane++)					\
+			{																\
+				zi[lane] = YTransform(y + lane, p->centerY, p->planeHeight,	\
+									  p->windowHeight);						\
+			}																\
+																			\
+			for (int i = 0; i < p->numIterations; i++)						\
+			{																\
+				LaneDouble prevR = zr;										\
+				LaneDouble prevI = zi;										\
+																			\
+				STEP(LaneDouble, zr, zi, cr, ci)							\
+																			\
+				LaneMask escaped = (zr * zr + zi * zi > radiusSq);			\
+				LaneMask fixed = (zr == prevR) & (zi == prevI);				\
+				LaneMask stopped = running & escaped;						\
+																			\
+				stages = (stages & ~stopped) | (((LaneMask){0} + i) &		\
+												stopped);					\
+				running &= ~(escaped | fixed);								\
+																			\
+				long long anyRunning = 0;									\
+																			\
+				for (int lane = 0; lane < JULIA_LANES; lane++)				\
+				{															\
+					anyRunning |= running[lane];							\
+				}															\
+				if (!anyRunning)											\
+				{															\
+					break;													\
+				}															\
+			}																\
+																			\
+			for (int lane = 0; lane < JULIA_LANES && y + lane < y1; lane++)	\
+			{																\
+				int stage = (int)stages[lane];								\
+																			\
+				colorMap[x][y + lane] = (stage == JULIA_IN_SET) ?			\
+										colorInSet() :						\
+										colorOutOfSet(stage);				\
+			}																\
+		}																	\
+	}																		\
+}
+
+#else
+
+#define DEFINE_JULIA_VECTOR_KERNEL_VECTOR(name, STEP)						\
+	DEFINE_JULIA_VECTOR_KERNEL_SCALAR(name, STEP)
+
+#endif
+
+#define DEFINE_JULIA_VECTOR_KERNEL_SCALAR(name, STEP)						\
+static void fill##name##Vector (const JuliaParams *p, SDL_Color **colorMap,	\
+								long x0, long x1, long xStep, long y0,		\
+								long y1, double escapeRadiusSq)				\
+{																			\
+	fill##name(p, colorMap, x0, x1, xStep, y0, y1, escapeRadiusSq);			\
+}
+
+#define DEFINE_JULIA_VECTOR_KERNEL(mapID, name, label, radius, STEP, DERIV,	\
+								   lanes)									\
+	DEFINE_JULIA_VECTOR_KERNEL_##lanes(name, STEP)
+
+JULIA_MAPS(DEFINE_JULIA_VECTOR_KERNEL)
+
+/**
+@typedef JuliaFill
+@brief A specialized fill function, as defined by DEFINE_JULIA_KERNEL.
+*/
+typedef void (*JuliaFill) (const JuliaParams *p, SDL_Color **colorMap,
+						   long x0, long x1, long xStep, long y0, long y1,
+						   double escapeRadiusSq);
+
+/**
+@typedef JuliaCountFill
+@brief A specialized fill function that stores stages instead of colors, as
+defined by DEFINE_JULIA_KERNEL.
+*/
+typedef void (*JuliaCountFill) (const JuliaParams *p, Sint32 *counts,
+								long stride, long x0, long y0, long x1,
+								long y1, double escapeRadiusSq);
+
+/**
+@typedef JuliaPointFill
+@brief A specialized fill function that stores the stages of a list of points,
+as defined by DEFINE_JULIA_KERNEL.
+*/
+typedef void (*JuliaPointFill) (const JuliaParams *p, const double *re,
+								const double *im, long numPoints,
+								Sint32 *counts, double escapeRadiusSq);
+
+/**
+@typedef JuliaResumeFill
+@brief A specialized fill function that continues the orbits of an orbit map,
+as defined by DEFINE_JULIA_KERNEL.
+*/
+typedef void (*JuliaResumeFill) (const JuliaParams *p, SDL_Color **colorMap,
+								 OrbitState **orbitMap, long x0, long x1,
+								 long xStep, long y0, long y1,
+								 double escapeRadiusSq);
+
+/**
+@typedef JuliaLaneFill
+@brief A specialized fill function, as defined by DEFINE_JULIA_LANE_KERNEL.
+*/
+typedef void (*JuliaLaneFill) (const JuliaParams *p, const double *cr,
+							   const double *ci, const double *escapeRadiusSq,
+							   SDL_Color **colorMap, const long *xOffset,
+							   const long *yOffset, long x0, long y0, long x1,
+							   long y1);
+
+/**
+@typedef JuliaMapInfo
+@brief Describes one iteration map: its name, base escape radius and the
+specialized functions that compute its Julia set.
+*/
+typedef struct JuliaMapInfo
+{
+	const char *name;
+	double escapeRadius;
+	JuliaFill fill;
+	JuliaFill fillVector;
+	JuliaFill fillDistance;
+	JuliaCountFill fillCounts;
+	JuliaPointFill fillPoints;
+	JuliaResumeFill fillResume;
+	JuliaLaneFill fillLanes;
+} JuliaMapInfo;
+
+#define JULIA_MAP_INFO(mapID, name, label, radius, STEP, DERIV, lanes)		\
+	[mapID] = { label, radius, fill##name, fill##name##Vector,				\
+				fill##name##Distance, fill##name##Counts,					\
+				fill##name##Points, fill##name##Resume,						\
+				fill##name##Lanes },
+
+static const JuliaMapInfo juliaMaps[NUM_JULIA_MAPS] = 
+{
+	JULIA_MAPS(JULIA_MAP_INFO)
+};
+
+/**
+@fn juliaEscapeRadius
+@brief Gives the escape radius used for a map and constant C. Any orbit that
+travels farther than this from the origin is guaranteed to escape.
+@param map The iteration map f(z).
+@param C The complex constant of the map.
+@return The escape radius.
+*/
+double juliaEscapeRadius (JuliaMap map, double complex C)
+{
+	double radius = juliaMaps[map].escapeRadius;
+	double distanceOfC = distanceFromOrigin(C);
+
+	return (distanceOfC > radius) ? distanceOfC : radius;
+}
+
+/**
+@fn juliaMapFromName
+@brief Looks up an iteration map by its command line name (e.g. "z3").
+@param name The name of the map.
+@return The matching map, or NUM_JULIA_MAPS if there is no such map.
+*/
+JuliaMap juliaMapFromName (const char *name)
+{
+	for (int map = 0; map < NUM_JULIA_MAPS; map++)
+	{
+		if (strcmp(name, juliaMaps[map].name) == 0)
+		{
+			return (JuliaMap)map;
+		}
+	}
+
+	return NUM_JULIA_MAPS;
+}
+
+/**
+@fn juliaMapName
+@brief Gives the command line name of an iteration map.
+@param map The iteration map.
+@return The name of the map.
+*/
+const char * juliaMapName (JuliaMap map)
+{
+	return juliaMaps[map].name;
+}
+
 /**
 @fn isInJuliaSet
 @brief Returns whether or not a point in the complex plane is in the Julia set
@@ -69,9 +891,10 @@ described by f(z) = z^2 + c.
 @details This function determines whether or not the point Z in the complex 
 plane is in the Julia set described by f(z) = z^2 + C. To do this, the function
 f is iterated on Z a finite number of times. If at any point the result is 
-greater than 2 units away from the origin, then Z is considered to NOT be in the
-Julia set. This function also writes to a buffer the number of iterations 
-applied before Z could be eliminated from the set.
+farther from the origin than the escape radius (2 units, or |C| if that is
+larger), then Z is considered to NOT be in the Julia set. This function also
+writes to a buffer the number of iterations applied before Z could be
+eliminated from the set.
 @param Z The point in the complex plane to check for membership in the Julia set.
 @param C A complex constant that helps to define the function f(z).
 @param numIterations The number of iterations to apply to point Z.
@@ -82,39 +905,56 @@ Z could be eliminated will be written.
 bool isInJuliaSet (double complex Z, double complex C, int numIterations,
 	    		   int * stageEliminated)
 {
-	double complex prevZ = Z;
-	double complex currentZ = Z;
+	double radius = juliaEscapeRadius(MAP_QUADRATIC, C);
+	int stage = iterateQuadratic(creal(Z), cimag(Z), creal(C), cimag(C),
+								 numIterations, radius * radius);
 
-	for (int i = 0; i < numIterations; i++)
+	if (stage == JULIA_IN_SET)
 	{
-		/* Apply the function f to Z. */
-		currentZ = f(currentZ, C);
-
-		/* Check if Z is now 2 or more units away from the origin. */
-		if (distanceFromOrigin(currentZ) > 2.0)
-		{
-			/* If so, record which iteration this is and return. */
-			*stageEliminated = i;
+		return true;
+	}
 
-			/* @DEBUG: Notify the user if a point is NOT in the set. */
-			//printf("(%f, %f) NOT in the Julia set!\n", creal(Z), cimag(Z));
+	*stageEliminated = stage;
 
-			return false;
-		}
+	return false;
+}
 
-		/* Check if Z stayed the same after an iteration. If so, it will remain
-		   the same for all of the remaining iterations. In this case, we know
-		   that Z cannot surpass 2 units from the origin and thus must be in
-		   the Julia set. */
-		if (currentZ == prevZ)
-		{
-			return true;
-		}
+/**
+@fn fillJulia
+@brief Evaluates the columns x0, x0 + xStep, ... below x1 and the rows y0 to
+y1 - 1 of the window with the kernel for the map and coloring of params.
+@details The specialized kernel is looked up once here; the per-point 
+iteration never goes through a function pointer. If an orbit map is given (and
+the image is colored by escape time), the orbits kept in it are continued
+instead of being started over. Otherwise images colored by escape time use the
+scalar or vector kernel, as chosen by params->kernel.
+*/
+static void fillJulia (const JuliaParams *params, SDL_Color **colorMap,
+					   OrbitState **orbitMap, long x0, long x1, long xStep,
+					   long y0, long y1)
+{
+	double radius = juliaEscapeRadius(params->map, params->C);
+	const JuliaMapInfo *info = &juliaMaps[params->map];
 
-		prevZ = currentZ;
+	if (params->coloring == COLOR_DISTANCE)
+	{
+		info->fillDistance(params, colorMap, x0, x1, xStep, y0, y1,
+						   radius * radius);
+	}
+	else if (orbitMap != NULL)
+	{
+		info->fillResume(params, colorMap, orbitMap, x0, x1, xStep, y0, y1,
+						 radius * radius);
+	}
+	else if (params->kernel == KERNEL_VECTOR)
+	{
+		info->fillVector(params, colorMap, x0, x1, xStep, y0, y1,
+						 radius * radius);
+	}
+	else
+	{
+		info->fill(params, colorMap, x0, x1, xStep, y0, y1, radius * radius);
 	}
-
-	return true;
 }
 
 /**
@@ -135,38 +975,200 @@ displayed in the window.
 checking if it is in the Julia set.
 @param colorMap An empty 2-dimensional array of colors of size 
 windowWidth x windowHeight that indicates the color of each pixel in the window.
-@param C The complex constant defining the function f(z) = z^2 + C.
+@param C The complex constant defining the function f(z).
 @param numberOfThreads The number of threads that work is split between.
 @param threadID The integer value indicating which thread is working right now.
+@param map The iteration map f(z) whose Julia set is computed.
 */
 void fillJuliaSet (double centerX, double centerY, double planeWidth, 
 				   double planeHeight, long windowWidth, long windowHeight, 
 				   int numIterations, SDL_Color **colorMap, double complex C,
-				   int numberOfThreads, int threadID)
+				   int numberOfThreads, int threadID, JuliaMap map)
+{
+	JuliaParams params;
+
+	params.centerX = centerX;
+	params.centerY = centerY;
+	params.planeWidth = planeWidth;
+	params.planeHeight = planeHeight;
+	params.C = C;
+	params.windowWidth = windowWidth;
+	params.windowHeight = windowHeight;
+	params.numIterations = numIterations;
+	params.map = map;
+	params.coloring = COLOR_ESCAPE_TIME;
+	params.renderer = RENDERER_ESCAPE_TIME;
+	params.kernel = KERNEL_SCALAR;
+
+	fillJuliaColumns(&params, colorMap, NULL, numberOfThreads, threadID);
+}
+
+/**
+@fn fillJuliaColumns
+@brief Evaluates every numberOfThreads-th column of the window, starting at
+column threadID, and colors the points appropriately.
+@param params The Julia set image being computed.
+@param colorMap The 2-dimensional array of colors of the whole image.
+@param orbitMap The orbits kept from an earlier fill with fewer iterations,
+which are continued and updated, or NULL to start every orbit over.
+@param numberOfThreads The number of threads that work is split between.
+@param threadID The integer value indicating which thread is working right now.
+*/
+void fillJuliaColumns (const JuliaParams *params, SDL_Color **colorMap,
+					   OrbitState **orbitMap, int numberOfThreads, int threadID)
+{
+	fillJulia(params, colorMap, orbitMap, threadID, params->windowWidth,
+			  numberOfThreads, 0, params->windowHeight);
+}
+
+/**
+@fn fillJuliaRegion
+@brief Evaluates the points in a rectangular region of the window and colors
+them appropriately.
+@param params The Julia set image being computed.
+@param colorMap The 2-dimensional array of colors of the whole image.
+@param orbitMap The orbits kept from an earlier fill with fewer iterations,
+which are continued and updated, or NULL to start every orbit over.
+@param x0 The first column of the region.
+@param y0 The first row of the region.
+@param x1 One past the last column of the region.
+@param y1 One past the last row of the region.
+*/
+void fillJuliaRegion (const JuliaParams *params, SDL_Color **colorMap,
+					  OrbitState **orbitMap, long x0, long y0, long x1, long y1)
+{
+	fillJulia(params, colorMap, orbitMap, x0, x1, 1, y0, y1);
+}
+
+/**
+@fn fillJuliaCounts
+@brief Evaluates the points in a rectangular region of the window and stores
+the iteration at which each one escaped, or JULIA_IN_SET, instead of a color.
+@param params The Julia set image being computed.
+@param counts The row-major array the region is stored in: the point (x, y)
+goes to counts[(y - y0) * stride + (x - x0)].
+@param stride The distance between two rows of counts.
+@param x0 The first column of the region.
+@param y0 The first row of the region.
+@param x1 One past the last column of the region.
+@param y1 One past the last row of the region.
+*/
+void fillJuliaCounts (const JuliaParams *params, Sint32 *counts, long stride,
+					  long x0, long y0, long x1, long y1)
+{
+	double radius = juliaEscapeRadius(params->map, params->C);
+
+	juliaMaps[params->map].fillCounts(params, counts, stride, x0, y0, x1, y1,
+									  radius * radius);
+}
+
+/**
+@fn fillJuliaPoints
+@brief Evaluates a list of arbitrary points of the complex plane and stores
+the iteration at which each one escaped, or JULIA_IN_SET.
+@param params The Julia set image being computed. Only its map, C and number
+of iterations are used.
+@param re The real part of each point.
+@param im The imaginary part of each point.
+@param numPoints The number of points.
+@param counts Where the stage of each point is stored.
+*/
+void fillJuliaPoints (const JuliaParams *params, const double *re,
+					  const double *im, long numPoints, Sint32 *counts)
 {
-	int stageEliminated = -1;
+	double radius = juliaEscapeRadius(params->map, params->C);
+
+	juliaMaps[params->map].fillPoints(params, re, im, numPoints, counts,
+									  radius * radius);
+}
 
-	/* Fill each column that is numberOfThreads apart, starting at column
-	   threadID. */
-	for (int x = threadID; x < windowWidth; x += numberOfThreads)
+/**
+@fn fillJuliaLanes
+@brief Evaluates the same region of JULIA_LANES images that show the same
+slice of the complex plane but differ in C, one image per kernel lane.
+@param params The slice of the complex plane, size and map shared by the
+images. Its C is ignored.
+@param C The complex constant of each image.
+@param colorMap The 2-dimensional array of colors that holds every image.
+@param xOffset The column of colorMap at which each image starts. Lanes with a
+negative offset are computed but not stored.
+@param yOffset The row of colorMap at which each image starts.
+@param x0 The first column of the region.
+@param y0 The first row of the region.
+@param x1 One past the last column of the region.
+@param y1 One past the last row of the region.
+*/
+void fillJuliaLanes (const JuliaParams *params, 
+					 const double complex C[JULIA_LANES], SDL_Color **colorMap,
+					 const long xOffset[JULIA_LANES], 
+					 const long yOffset[JULIA_LANES], long x0, long y0,
+					 long x1, long y1)
+{
+	double cr[JULIA_LANES], ci[JULIA_LANES], escapeRadiusSq[JULIA_LANES];
+
+	for (int lane = 0; lane < JULIA_LANES; lane++)
 	{
-		for (int y = 0; y < windowHeight; y++)
-		{
-			/* Translate from window coordinates to complex plane coordinates. */
-			double compX = XTransform(x, centerX, planeWidth, windowWidth);
-			double compY = YTransform(y, centerY, planeHeight, windowHeight);
-			/* Define Z based on these coordinates. */
-			double complex Z = compX + compY * I;
-
-			/* Check if Z is in the Julia set or not. */
-			if (isInJuliaSet( Z, C, numIterations, &stageEliminated ))
-			{
-				colorMap[x][y] = colorInSet();
-			}
-			else
-			{
-				colorMap[x][y] = colorOutOfSet(stageEliminated);
-			}
-		}
+		double radius = juliaEscapeRadius(params->map, C[lane]);
+
+		cr[lane] = creal(C[lane]);
+		ci[lane] = cimag(C[lane]);
+		escapeRadiusSq[lane] = radius * radius;
+	}
+
+	juliaMaps[params->map].fillLanes(params, cr, ci, escapeRadiusSq, colorMap,
+									 xOffset, yOffset, x0, y0, x1, y1);
+}
+
+/**
+@fn newOrbitMap
+@brief Dynamically allocates a windowWidth x windowHeight 2D array of orbits,
+none of which has been iterated yet.
+@param windowWidth The width (in pixels) of the window.
+@param windowHeight The height (in pixels) of the window.
+@return A dynamically allocated 2D array of OrbitState structs.
+*/
+OrbitState ** newOrbitMap (long windowWidth, long windowHeight)
+{
+	OrbitState ** orbitMap = (OrbitState**)malloc(sizeof(OrbitState*) * 
+												  windowWidth);
+
+	/* The orbits live in one zero-filled block, and a zero iteration count
+	   marks an orbit that has not been started. The block is left untouched
+	   so that each page is placed near the thread that fills it. */
+	OrbitState *orbits = (OrbitState*)allocateBuffer(sizeof(OrbitState) * 
+													 windowWidth * 
+													 windowHeight);
+
+	for (long i = 0; i < windowWidth; i++)
+	{
+		orbitMap[i] = orbits + i * windowHeight;
 	}
+
+	return orbitMap;
+}
+
+/**
+@fn clearOrbitMap
+@brief Marks every orbit of an orbit map as not iterated yet, e.g. after the
+view has changed.
+@param orbitMap The orbit map to clear.
+@param windowWidth The width of the orbit map.
+@param windowHeight The height of the orbit map.
+*/
+void clearOrbitMap (OrbitState ** orbitMap, long windowWidth, long windowHeight)
+{
+	memset(orbitMap[0], 0, sizeof(OrbitState) * windowWidth * windowHeight);
+}
+
+/**
+@fn freeOrbitMap
+@brief Frees a dynamically allocated orbit map.
+@param orbitMap The orbit map to be freed.
+@param windowWidth The width of the orbit map.
+@param windowHeight The height of the orbit map.
+*/
+void freeOrbitMap (OrbitState ** orbitMap, long windowWidth, long windowHeight)
+{
+	freeBuffer(orbitMap[0], sizeof(OrbitState) * windowWidth * windowHeight);
+	free(orbitMap);
 }
\ No newline at end of file
@@ -13,9 +13,38 @@ the complex plane.
 #include <SDL2/SDL.h>
 
 #include "HelperFunctions.h"
+#include "JuliaTypes.h"
 
 #include "Drawing.h"
 
+/**
+@def ORBIT_BOUNDED
+@brief The stage of an orbit that has not escaped within the iterations done
+so far. More iterations may still let it escape.
+*/
+#define ORBIT_BOUNDED -1
+
+/**
+@def ORBIT_SETTLED
+@brief The stage of an orbit that reached a fixed point and so can never
+escape, however many more iterations are done.
+*/
+#define ORBIT_SETTLED -2
+
+/**
+@def JULIA_LANES
+@brief The number of images that fillJuliaLanes() computes side by side, one
+per lane of the kernel.
+*/
+#define JULIA_LANES 4
+
+/**
+@def DISTANCE_ESCAPE_RADIUS
+@brief The smallest escape radius used when coloring by distance. The distance
+estimate is only accurate once the orbit is far from the origin.
+*/
+#define DISTANCE_ESCAPE_RADIUS 1000.0
+
 /**
 @fn f
 @brief Applies the function of the form f(z) = z^2 + C to the point Z in the
@@ -75,14 +104,152 @@ displayed in the window.
 checking if it is in the Julia set.
 @param colorMap An empty 2-dimensional array of colors of size 
 windowWidth x windowHeight that indicates the color of each pixel in the window.
-@param C The complex constant defining the function f(z) = z^2 + C.
+@param C The complex constant defining the function f(z).
 @param numberOfThreads The number of threads that work is split between.
 @param threadID The integer value indicating which thread is working right now.
+@param map The iteration map f(z) whose Julia set is computed.
 */
 void fillJuliaSet (double centerX, double centerY, double planeWidth, 
 				   double planeHeight, long windowWidth, long windowHeight, 
 				   int numIterations, SDL_Color **colorMap, double complex C,
-				   int numberOfThreads, int threadID);
+				   int numberOfThreads, int threadID, JuliaMap map);
+
+/**
+@fn fillJuliaColumns
+@brief Evaluates every numberOfThreads-th column of the window, starting at
+column threadID, and colors the points appropriately.
+@param params The Julia set image being computed.
+@param colorMap The 2-dimensional array of colors of the whole image.
+@param orbitMap The orbits kept from an earlier fill with fewer iterations,
+which are continued and updated, or NULL to start every orbit over.
+@param numberOfThreads The number of threads that work is split between.
+@param threadID The integer value indicating which thread is working right now.
+*/
+void fillJuliaColumns (const JuliaParams *params, SDL_Color **colorMap,
+					   OrbitState **orbitMap, int numberOfThreads, int threadID);
+
+/**
+@fn fillJuliaRegion
+@brief Evaluates the points in a rectangular region of the window and colors
+them appropriately.
+@param params The Julia set image being computed.
+@param colorMap The 2-dimensional array of colors of the whole image.
+@param orbitMap The orbits kept from an earlier fill with fewer iterations,
+which are continued and updated, or NULL to start every orbit over.
+@param x0 The first column of the region.
+@param y0 The first row of the region.
+@param x1 One past the last column of the region.
+@param y1 One past the last row of the region.
+*/
+void fillJuliaRegion (const JuliaParams *params, SDL_Color **colorMap,
+					  OrbitState **orbitMap, long x0, long y0, long x1, long y1);
+
+/**
+@fn fillJuliaCounts
+@brief Evaluates the points in a rectangular region of the window and stores
+the iteration at which each one escaped, or JULIA_IN_SET, instead of a color.
+@param params The Julia set image being computed.
+@param counts The row-major array the region is stored in: the point (x, y)
+goes to counts[(y - y0) * stride + (x - x0)].
+@param stride The distance between two rows of counts.
+@param x0 The first column of the region.
+@param y0 The first row of the region.
+@param x1 One past the last column of the region.
+@param y1 One past the last row of the region.
+*/
+void fillJuliaCounts (const JuliaParams *params, Sint32 *counts, long stride,
+					  long x0, long y0, long x1, long y1);
+
+/**
+@fn fillJuliaPoints
+@brief Evaluates a list of arbitrary points of the complex plane and stores
+the iteration at which each one escaped, or JULIA_IN_SET.
+@param params The Julia set image being computed. Only its map, C and number
+of iterations are used.
+@param re The real part of each point.
+@param im The imaginary part of each point.
+@param numPoints The number of points.
+@param counts Where the stage of each point is stored.
+*/
+void fillJuliaPoints (const JuliaParams *params, const double *re,
+					  const double *im, long numPoints, Sint32 *counts);
+
+/**
+@fn fillJuliaLanes
+@brief Evaluates the same region of JULIA_LANES images that show the same
+slice of the complex plane but differ in C, one image per kernel lane.
+@param params The slice of the complex plane, size and map shared by the
+images. Its C is ignored.
+@param C The complex constant of each image.
+@param colorMap The 2-dimensional array of colors that holds every image.
+@param xOffset The column of colorMap at which each image starts. Lanes with a
+negative offset are computed but not stored.
+@param yOffset The row of colorMap at which each image starts.
+@param x0 The first column of the region.
+@param y0 The first row of the region.
+@param x1 One past the last column of the region.
+@param y1 One past the last row of the region.
+*/
+void fillJuliaLanes (const JuliaParams *params, 
+					 const double complex C[JULIA_LANES], SDL_Color **colorMap,
+					 const long xOffset[JULIA_LANES], 
+					 const long yOffset[JULIA_LANES], long x0, long y0,
+					 long x1, long y1);
+
+/**
+@fn juliaEscapeRadius
+@brief Gives the escape radius used for a map and constant C. Any orbit that
+travels farther than this from the origin is guaranteed to escape.
+@param map The iteration map f(z).
+@param C The complex constant of the map.
+@return The escape radius.
+*/
+double juliaEscapeRadius (JuliaMap map, double complex C);
+
+/**
+@fn juliaMapFromName
+@brief Looks up an iteration map by its command line name (e.g. "z3").
+@param name The name of the map.
+@return The matching map, or NUM_JULIA_MAPS if there is no such map.
+*/
+JuliaMap juliaMapFromName (const char *name);
+
+/**
+@fn juliaMapName
+@brief Gives the command line name of an iteration map.
+@param map The iteration map.
+@return The name of the map.
+*/
+const char * juliaMapName (JuliaMap map);
+
+/**
+@fn newOrbitMap
+@brief Dynamically allocates a windowWidth x windowHeight 2D array of orbits,
+none of which has been iterated yet.
+@param windowWidth The width (in pixels) of the window.
+@param windowHeight The height (in pixels) of the window.
+@return A dynamically allocated 2D array of OrbitState structs.
+*/
+OrbitState ** newOrbitMap (long windowWidth, long windowHeight);
+
+/**
+@fn clearOrbitMap
+@brief Marks every orbit of an orbit map as not iterated yet, e.g. after the
+view has changed.
+@param orbitMap The orbit map to clear.
+@param windowWidth The width of the orbit map.
+@param windowHeight The height of the orbit map.
+*/
+void clearOrbitMap (OrbitState ** orbitMap, long windowWidth, long windowHeight);
+
+/**
+@fn freeOrbitMap
+@brief Frees a dynamically allocated orbit map.
+@param orbitMap The orbit map to be freed.
+@param windowWidth The width of the orbit map.
+@param windowHeight The height of the orbit map.
+*/
+void freeOrbitMap (OrbitState ** orbitMap, long windowWidth, long windowHeight);
 
 #endif /* JULIASET_H */
 
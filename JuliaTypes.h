@@ -0,0 +1,48 @@
+/**
+@file JuliaTypes.h
+@author Rob Thomas
+@brief Contains the types that describe a Julia set image, shared by the
+program and the render library (see JuliaRender.h).
+*/
+
+#ifndef JULIATYPES_H
+#define JULIATYPES_H
+
+
+/**
+@def JULIA_IN_SET
+@brief The stage returned by the iteration kernels for a point that never
+escaped, i.e. a point that is in the Julia set.
+*/
+#define JULIA_IN_SET -1
+
+/**
+@typedef JuliaMap
+@brief Identifies the iteration map f(z) whose Julia set is being computed.
+Each map has its own specialized kernel and escape radius in JuliaSet.c.
+*/
+typedef enum JuliaMap
+{
+	MAP_QUADRATIC,		/* f(z) = z^2 + C */
+	MAP_POWER3,			/* f(z) = z^3 + C */
+	MAP_POWER4,			/* f(z) = z^4 + C */
+	MAP_POWER5,			/* f(z) = z^5 + C */
+	MAP_POWER6,			/* f(z) = z^6 + C */
+	MAP_POWER7,			/* f(z) = z^7 + C */
+	MAP_POWER8,			/* f(z) = z^8 + C */
+	MAP_BURNING_SHIP,	/* f(z) = (|Re(z)| + i|Im(z)|)^2 + C */
+	MAP_CUBIC,			/* f(z) = z^3 - z + C */
+	NUM_JULIA_MAPS
+} JuliaMap;
+
+/**
+@typedef ColoringMode
+@brief Identifies how the points of a Julia set image are colored.
+*/
+typedef enum ColoringMode
+{
+	COLOR_ESCAPE_TIME,	/* By the iteration at which a point escaped. */
+	COLOR_DISTANCE		/* By the estimated distance to the Julia set. */
+} ColoringMode;
+
+#endif /* JULIATYPES_H */
@@ -0,0 +1,452 @@
+/**
+@file PngWriter.c
+@author Rob Thomas
+@brief Contains functions for writing a Julia set image to disk as a PNG
+image, compressed by several threads at once.
+*/
+
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "HelperFunctions.h"
+#include "JuliaSet.h"
+
+#include "PngWriter.h"
+
+
+/**
+@def PNG_BYTES_PER_PIXEL
+@brief The size (in bytes) of one pixel of the PNG image (8-bit RGBA).
+*/
+#define PNG_BYTES_PER_PIXEL 4
+
+/**
+@def PNG_COMPRESSION_LEVEL
+@brief The zlib compression level of the strips.
+*/
+#define PNG_COMPRESSION_LEVEL 6
+
+
+/**
+@fn isPngFile
+@brief Tells whether an image should be written as a PNG image.
+@param fileName The name of the image file.
+@return true if fileName ends in ".png" (in any case), false otherwise.
+*/
+bool isPngFile (const char *fileName)
+{
+	const char *extension = ".png";
+	size_t length = strlen(fileName);
+
+	if (length < 4)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (tolower((unsigned char)fileName[length - 4 + i]) != extension[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+@fn putPngU32
+@brief Stores a 32-bit number in the big-endian byte order used by PNG.
+@param bytes Where the number is stored.
+@param value The number.
+*/
+static void putPngU32 (unsigned char *bytes, Uint32 value)
+{
+	bytes[0] = (unsigned char)(value >> 24);
+	bytes[1] = (unsigned char)(value >> 16);
+	bytes[2] = (unsigned char)(value >> 8);
+	bytes[3] = (unsigned char)value;
+}
+
+/**
+@fn filterRow
+@brief Applies the PNG filter that makes a row cheapest to compress: none,
+sub (the difference from the pixel to the left) or up (the difference from
+the pixel above), judged by the sum of the absolute values of the result.
+@param row The row.
+@param above The row above, or NULL if it may not be used.
+@param rowBytes The size (in bytes) of a row.
+@param out Where the filter type followed by the filtered row is stored.
+*/
+static void filterRow (const unsigned char *row, const unsigned char *above,
+					   size_t rowBytes, unsigned char *out)
+{
+	unsigned long costNone = 0, costSub = 0, costUp = ULONG_MAX;
+
+	/* Separate branch-free loops, so that the compiler can vectorize them. */
+	for (size_t i = 0; i < rowBytes; i++)
+	{
+		costNone += abs((signed char)row[i]);
+	}
+
+	for (size_t i = 0; i < rowBytes; i++)
+	{
+		unsigned char left = (i >= PNG_BYTES_PER_PIXEL) ?
+							 row[i - PNG_BYTES_PER_PIXEL] : 0;
+
+		costSub += abs((signed char)(row[i] - left));
+	}
+
+	if (above != NULL)
+	{
+		costUp = 0;
+
+		for (size_t i = 0; i < rowBytes; i++)
+		{
+			costUp += abs((signed char)(row[i] - above[i]));
+		}
+	}
+
+	/*** Store the row with the cheapest filter. ***/
+	if (costUp < costSub && costUp < costNone)
+	{
+		out[0] = 2;
+
+		for (size_t i = 0; i < rowBytes; i++)
+		{
+			out[i + 1] = (unsigned char)(row[i] - above[i]);
+		}
+	}
+	else if (costSub < costNone)
+	{
+		out[0] = 1;
+		memcpy(out + 1, row, PNG_BYTES_PER_PIXEL);
+
+		for (size_t i = PNG_BYTES_PER_PIXEL; i < rowBytes; i++)
+		{
+			out[i + 1] = (unsigned char)(row[i] - row[i - PNG_BYTES_PER_PIXEL]);
+		}
+	}
+	else
+	{
+		out[0] = 0;
+		memcpy(out + 1, row, rowBytes);
+	}
+}
+
+/**
+@fn compressStrip
+@brief Filters and deflates one strip of the image.
+@param encoder The image being compressed.
+@param strip The index of the strip.
+@param pixels A buffer of PNG_STRIP_ROWS rows of pixels.
+@param filtered A buffer of PNG_STRIP_ROWS filtered rows.
+@return true if the strip was compressed, false otherwise.
+*/
+static bool compressStrip (PngEncoder *encoder, long strip,
+						   unsigned char *pixels, unsigned char *filtered)
+{
+	PngStrip *s = &encoder->strips[strip];
+	long windowWidth = encoder->params.windowWidth;
+	long windowHeight = encoder->params.windowHeight;
+	long y0 = strip * PNG_STRIP_ROWS;
+	long y1 = (y0 + PNG_STRIP_ROWS < windowHeight) ? y0 + PNG_STRIP_ROWS :
+			  windowHeight;
+	size_t rowBytes = (size_t)windowWidth * PNG_BYTES_PER_PIXEL;
+
+	/* Turn the columns of the strip into rows. SDL_Color has the same layout
+	   as an RGBA pixel. */
+	for (long x = 0; x < windowWidth; x++)
+	{
+		const SDL_Color *column = encoder->colorMap[x];
+
+		for (long y = y0; y < y1; y++)
+		{
+			memcpy(pixels + (y - y0) * rowBytes + x * PNG_BYTES_PER_PIXEL,
+				   &column[y], PNG_BYTES_PER_PIXEL);
+		}
+	}
+
+	/* The row above the strip belongs to another thread and may not be
+	   finished, so the first row of a strip is never filtered against it. */
+	for (long y = y0; y < y1; y++)
+	{
+		filterRow(pixels + (y - y0) * rowBytes,
+				  (y > y0) ? pixels + (y - y0 - 1) * rowBytes : NULL,
+				  rowBytes, filtered + (y - y0) * (rowBytes + 1));
+	}
+
+	s->rawSize = (size_t)(y1 - y0) * (rowBytes + 1);
+	s->adler = adler32(adler32(0L, Z_NULL, 0), filtered, (uInt)s->rawSize);
+
+	/*** Deflate the strip as a raw stream. The first strip makes room for
+		 the zlib header, and only the last strip ends the stream. ***/
+	z_stream stream;
+	bool first = (strip == 0);
+	bool last = (strip == encoder->numStrips - 1);
+
+	memset(&stream, 0, sizeof(stream));
+
+	if (deflateInit2(&stream, PNG_COMPRESSION_LEVEL, Z_DEFLATED, -MAX_WBITS,
+					 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		return false;
+	}
+
+	size_t bound = deflateBound(&stream, (uLong)s->rawSize) + 16;
+
+	s->data = (unsigned char*)malloc(bound);
+
+	if (s->data == NULL)
+	{
+		deflateEnd(&stream);
+
+		return false;
+	}
+
+	size_t offset = first ? 2 : 0;
+
+	if (first)
+	{
+		s->data[0] = 0x78;
+		s->data[1] = 0x9C;
+	}
+
+	stream.next_in = filtered;
+	stream.avail_in = (uInt)s->rawSize;
+	stream.next_out = s->data + offset;
+	stream.avail_out = (uInt)(bound - offset);
+
+	int status = deflate(&stream, last ? Z_FINISH : Z_FULL_FLUSH);
+
+	s->size = offset + stream.total_out;
+	deflateEnd(&stream);
+
+	if (status != (last ? Z_STREAM_END : Z_OK) || stream.avail_in != 0)
+	{
+		free(s->data);
+		s->data = NULL;
+
+		return false;
+	}
+
+	return true;
+}
+
+/**
+@fn partialPng
+@brief Computes (if asked to) and compresses strips of a PNG image until none
+are left.
+@param data A void pointer to be cast into a PngEncoder struct.
+*/
+int partialPng (void *data)
+{
+	PngEncoder *encoder = (PngEncoder*)data;
+	size_t rowBytes = (size_t)encoder->params.windowWidth *
+					  PNG_BYTES_PER_PIXEL;
+	int threadID = SDL_AtomicAdd(&encoder->nextThread, 1);
+
+	if (encoder->pinning != PIN_NONE)
+	{
+		pinThread(threadID, encoder->pinning);
+	}
+
+	unsigned char *pixels = (unsigned char*)malloc(PNG_STRIP_ROWS * rowBytes);
+	unsigned char *filtered = (unsigned char*)malloc(PNG_STRIP_ROWS *
+													 (rowBytes + 1));
+	long strip;
+
+	while ((strip = SDL_AtomicAdd(&encoder->nextStrip, 1)) <
+		   encoder->numStrips)
+	{
+		long y0 = strip * PNG_STRIP_ROWS;
+		long y1 = (y0 + PNG_STRIP_ROWS < encoder->params.windowHeight) ?
+				  y0 + PNG_STRIP_ROWS : encoder->params.windowHeight;
+
+		if (encoder->compute)
+		{
+			fillJuliaRegion(&encoder->params, encoder->colorMap, NULL, 0, y0,
+							encoder->params.windowWidth, y1);
+		}
+
+		if (pixels == NULL || filtered == NULL ||
+			!compressStrip(encoder, strip, pixels, filtered))
+		{
+			encoder->strips[strip].data = NULL;
+		}
+
+		/* Hand the strip over to the thread that writes the file. */
+		SDL_LockMutex(encoder->lock);
+		encoder->strips[strip].ready = true;
+		SDL_CondBroadcast(encoder->stripReady);
+		SDL_UnlockMutex(encoder->lock);
+	}
+
+	free(pixels);
+	free(filtered);
+
+	return 0;
+}
+
+/**
+@fn writePngChunk
+@brief Writes one chunk of a PNG file: its length, type, data and CRC.
+@param file The PNG file.
+@param type The four letters of the type of the chunk.
+@param data The data of the chunk.
+@param size The size (in bytes) of the data.
+@return true if the chunk was written, false otherwise.
+*/
+static bool writePngChunk (FILE *file, const char *type,
+						   const unsigned char *data, size_t size)
+{
+	unsigned char header[8];
+	unsigned char trailer[4];
+	uLong crc = crc32(0L, Z_NULL, 0);
+
+	putPngU32(header, (Uint32)size);
+	memcpy(header + 4, type, 4);
+
+	crc = crc32(crc, header + 4, 4);
+
+	if (size > 0)
+	{
+		crc = crc32(crc, data, (uInt)size);
+	}
+
+	putPngU32(trailer, (Uint32)crc);
+
+	return fwrite(header, 1, 8, file) == 8 &&
+		   (size == 0 || fwrite(data, 1, size, file) == size) &&
+		   fwrite(trailer, 1, 4, file) == 4;
+}
+
+/**
+@fn writePng
+@brief Writes an image to disk as a PNG image, compressing its strips in
+numberOfThreads threads.
+@param fileName The name of the file to write.
+@param params The image. Its colors are computed strip by strip just before
+they are compressed if compute is true.
+@param colorMap The 2D array of colors describing each pixel of the image.
+@param compute Whether the worker threads should compute the image too, or
+only compress the colors that are already in colorMap.
+@param pinning How the worker threads are pinned to CPUs.
+@param numberOfThreads The number of worker threads.
+@return true if the image was written, false otherwise.
+*/
+bool writePng (const char *fileName, const JuliaParams *params,
+			   SDL_Color **colorMap, bool compute, PinPolicy pinning,
+			   long numberOfThreads)
+{
+	static const unsigned char signature[8] =
+	{
+		0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+	};
+
+	PngEncoder encoder;
+
+	encoder.params = *params;
+	encoder.colorMap = colorMap;
+	encoder.compute = compute;
+	encoder.pinning = pinning;
+	encoder.numStrips = (params->windowHeight + PNG_STRIP_ROWS - 1) /
+						PNG_STRIP_ROWS;
+	encoder.strips = (PngStrip*)calloc(encoder.numStrips, sizeof(PngStrip));
+	encoder.lock = SDL_CreateMutex();
+	encoder.stripReady = SDL_CreateCond();
+	SDL_AtomicSet(&encoder.nextStrip, 0);
+	SDL_AtomicSet(&encoder.nextThread, 0);
+
+	FILE *file = fopen(fileName, "wb");
+
+	if (encoder.strips == NULL || encoder.lock == NULL ||
+		encoder.stripReady == NULL || file == NULL)
+	{
+		if (file != NULL)
+		{
+			fclose(file);
+		}
+		free(encoder.strips);
+		SDL_DestroyMutex(encoder.lock);
+		SDL_DestroyCond(encoder.stripReady);
+
+		return false;
+	}
+
+	/*** Start compressing. ***/
+	SDL_Thread *threadList[numberOfThreads];
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		threadList[threadID] = SDL_CreateThread(partialPng, "PNG Thread",
+												(void*)&encoder);
+	}
+
+	/*** Write the header while the first strips are being compressed. ***/
+	unsigned char ihdr[13];
+
+	putPngU32(ihdr, (Uint32)params->windowWidth);
+	putPngU32(ihdr + 4, (Uint32)params->windowHeight);
+	ihdr[8] = 8;		/* Bits per channel. */
+	ihdr[9] = 6;		/* RGBA. */
+	ihdr[10] = 0;		/* Deflate. */
+	ihdr[11] = 0;		/* Adaptive filtering. */
+	ihdr[12] = 0;		/* Not interlaced. */
+
+	bool written = fwrite(signature, 1, sizeof(signature), file) ==
+				   sizeof(signature) &&
+				   writePngChunk(file, "IHDR", ihdr, sizeof(ihdr));
+
+	/*** Write each strip as soon as it and all strips above it are ready. ***/
+	uLong adler = adler32(0L, Z_NULL, 0);
+
+	for (long strip = 0; strip < encoder.numStrips; strip++)
+	{
+		PngStrip *s = &encoder.strips[strip];
+
+		SDL_LockMutex(encoder.lock);
+
+		while (!s->ready)
+		{
+			SDL_CondWait(encoder.stripReady, encoder.lock);
+		}
+
+		SDL_UnlockMutex(encoder.lock);
+
+		written = written && s->data != NULL &&
+				  writePngChunk(file, "IDAT", s->data, s->size);
+		adler = adler32_combine(adler, s->adler, (z_off_t)s->rawSize);
+
+		free(s->data);
+		s->data = NULL;
+	}
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		SDL_WaitThread(threadList[threadID], NULL);
+	}
+
+	/*** End the zlib stream with its checksum, and the image. ***/
+	unsigned char checksum[4];
+
+	putPngU32(checksum, (Uint32)adler);
+
+	written = written && writePngChunk(file, "IDAT", checksum, 4) &&
+			  writePngChunk(file, "IEND", NULL, 0);
+	written = (fclose(file) == 0) && written;
+
+	free(encoder.strips);
+	SDL_DestroyMutex(encoder.lock);
+	SDL_DestroyCond(encoder.stripReady);
+
+	return written;
+}
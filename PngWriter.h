@@ -0,0 +1,104 @@
+/**
+@file PngWriter.h
+@author Rob Thomas
+@brief Contains functions for writing a Julia set image to disk as a PNG
+image, compressed by several threads at once.
+@details The image is cut into strips of PNG_STRIP_ROWS rows. Each strip is
+filtered and deflated on its own by whichever worker thread takes it, ending
+with a full flush so that the strips can simply be written one after the
+other as a single zlib stream; the checksum of the stream is put together
+from the checksums of the strips with adler32_combine(). When the workers also
+compute the strips, each strip is compressed as soon as it is finished while
+the other threads are still computing, and the calling thread writes strips
+to disk in order as they become ready.
+*/
+
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "HelperFunctions.h"
+
+
+/**
+@def PNG_STRIP_ROWS
+@brief The number of rows of the image compressed together by one thread.
+*/
+#define PNG_STRIP_ROWS 32
+
+
+/**
+@typedef PngStrip
+@brief The PngStrip struct holds one compressed strip of a PNG image. ready
+is set once the strip has been compressed, or once compressing it has failed,
+in which case data is NULL.
+*/
+typedef struct PngStrip
+{
+	unsigned char *data;
+	size_t size;
+	unsigned long adler;
+	size_t rawSize;
+	bool ready;
+} PngStrip;
+
+/**
+@typedef PngEncoder
+@brief The PngEncoder struct describes a PNG image that is being compressed.
+Worker threads take the next strip from nextStrip. If compute is true they
+fill the strip with params before compressing it.
+*/
+typedef struct PngEncoder
+{
+	JuliaParams params;
+	SDL_Color **colorMap;
+	bool compute;
+	PinPolicy pinning;
+	long numStrips;
+	PngStrip *strips;
+	SDL_atomic_t nextStrip;
+	SDL_atomic_t nextThread;
+	SDL_mutex *lock;
+	SDL_cond *stripReady;
+} PngEncoder;
+
+
+/**
+@fn isPngFile
+@brief Tells whether an image should be written as a PNG image.
+@param fileName The name of the image file.
+@return true if fileName ends in ".png" (in any case), false otherwise.
+*/
+bool isPngFile (const char *fileName);
+
+/**
+@fn partialPng
+@brief Computes (if asked to) and compresses strips of a PNG image until none
+are left.
+@param data A void pointer to be cast into a PngEncoder struct.
+*/
+int partialPng (void *data);
+
+/**
+@fn writePng
+@brief Writes an image to disk as a PNG image, compressing its strips in
+numberOfThreads threads.
+@param fileName The name of the file to write.
+@param params The image. Its colors are computed strip by strip just before
+they are compressed if compute is true.
+@param colorMap The 2D array of colors describing each pixel of the image.
+@param compute Whether the worker threads should compute the image too, or
+only compress the colors that are already in colorMap.
+@param pinning How the worker threads are pinned to CPUs.
+@param numberOfThreads The number of worker threads.
+@return true if the image was written, false otherwise.
+*/
+bool writePng (const char *fileName, const JuliaParams *params,
+			   SDL_Color **colorMap, bool compute, PinPolicy pinning,
+			   long numberOfThreads);
+
+#endif /* PNGWRITER_H */
@@ -7,12 +7,23 @@ Julia set.
 
 
 #include <complex.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_thread.h>
 
+#include "Atlas.h"
+#include "Autotune.h"
+#include "Batch.h"
+#include "Checkpoint.h"
 #include "JuliaSet.h"
 #include "Drawing.h"
 #include "HelperFunctions.h"
+#include "InverseIteration.h"
+#include "PngWriter.h"
+#include "Pyramid.h"
+#include "TileArchive.h"
+#include "Viewer.h"
+#include "Zoom.h"
 
 /**
 @def NUM_ITERATIONS
@@ -21,6 +32,13 @@ the Julia set.
 */
 #define NUM_ITERATIONS 100
 
+/**
+@def TILE_COLUMNS
+@brief The width (in columns) of the tiles that are shown as soon as they are
+finished when the Julia set is drawn in a window.
+*/
+#define TILE_COLUMNS 8
+
 /**
 @def SUCCESS
 @brief The error code for a successful operation.
@@ -34,6 +52,39 @@ user to close the window).
 */
 #define FAILURE 1
 
+/**
+@fn runThreads
+@brief Runs partialFill() in one new thread per data packet and waits for all
+of them to finish.
+@param dataList The data packet of each thread.
+@param numberOfThreads The number of threads to run.
+@return How long (in milliseconds) the threads took.
+*/
+static Uint32 runThreads (ThreadData dataList[], long numberOfThreads)
+{
+	SDL_Thread *threadList[numberOfThreads];
+
+	Uint32 startTime = SDL_GetTicks();
+
+		/* Create the number of threads specified by the user, and divide the 
+		   work up so that each thread fills in the same number of columns in 
+		   the color map. */
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		/* Make a new thread and pass it the appropriate data packet. */
+		threadList[threadID] = SDL_CreateThread( partialFill, "Current Thread",
+												(void*)&(dataList[threadID]) );
+	}
+
+		/* Wait for each thread to finish before drawing the Julia set. */
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		SDL_WaitThread(threadList[threadID], NULL);
+	}
+
+	return SDL_GetTicks() - startTime;
+}
+
 /**
 @fn main
 @brief Generates an image of a Julia set with the properties given by the user.
@@ -54,10 +105,88 @@ user to close the window).
 	   characterizes each Julia set (a floating point number)
 	b: the imaginary component of the complex constant C (a floating point number)
 	numberOfThreads: the number of threads to be used to calculate Julia set
-					 (a positive integer)
+					 (a positive integer, or auto for the number chosen by
+					 --autotune)
+The required arguments may be followed by options of the form --name=value
+(see getOptions()), e.g. --map=z3 to draw the Julia set of f(z) = z^3 + C.
+The window is opened right away and each part of the image is shown as soon
+as it is finished. While the window is open, clicking zooms in (left button)
+or out (right button) around the click, the arrow keys move the view and
+backspace goes back to the previous view (see runViewer()). Pressing D doubles
+the number of iterations. Only the orbits that were still bounded are
+continued, from where they stopped.
+
+Alternatively, main() may be called as
+	Project04_01 --batch jobFile numberOfThreads
+to render every image described by jobFile to disk (see runBatch()), or as
+	Project04_01 --atlas columns rows thumbnailSize minA minB maxA maxB 
+					   numberOfThreads outputFile
+to render a grid of thumbnails that sample C over a rectangle (see runAtlas()),
+or as
+	Project04_01 --archive windowWidth windowHeight planeWidth planeHeight
+						   centerX centerY a b tileSize numberOfThreads 
+						   outputFile
+to store the escape times of the image as a compressed tile archive (see
+runArchive()), whose tiles can be read back one at a time with
+	Project04_01 --read-tile archiveFile column row outputFile
+or as
+	Project04_01 --zoom windowWidth windowHeight startWidth endWidth centerX
+						centerY a b numFrames numberOfThreads outputPrefix
+to render the frames of a video zooming in on (centerX, centerY) (see
+runZoom()), or as
+	Project04_01 --pyramid windowWidth windowHeight planeWidth planeHeight
+						   centerX centerY a b numberOfThreads outputName
+to render the image as a Deep Zoom tile pyramid, whose coarser levels are
+shrunk from the finest one instead of being computed again (see
+runPyramid()), or as
+	Project04_01 --autotune
+to measure the number of threads, tile size and kernel that render fastest on
+this machine (see runAutotune()). They are saved to AUTOTUNE_PROFILE_FILE and
+used by every later render that does not choose them itself.
+
+With --output=FILE, long renders can be protected with --checkpoint=FILE:
+the finished columns are saved every --checkpoint-interval=SECONDS, and 
+running the same command again with --resume only computes the columns that
+are missing (see Checkpoint.h).
+
+With --frame-budget=MS, the window keeps to MS milliseconds per frame: each
+view is first shown at whatever resolution and number of iterations fit, and
+refined over the following frames while the user does nothing (see
+Deadline.h).
 */
 int main (int argc, char *argv[])
 {
+	/*** Hand over to batch, atlas, archive, zoom, pyramid or autotune mode if
+		 it was requested. ***/
+	if (argc > 1 && strcmp(argv[1], "--batch") == 0)
+	{
+		exit(runBatch(argc, argv, NUM_ITERATIONS));
+	}
+	if (argc > 1 && strcmp(argv[1], "--atlas") == 0)
+	{
+		exit(runAtlas(argc, argv, NUM_ITERATIONS));
+	}
+	if (argc > 1 && strcmp(argv[1], "--archive") == 0)
+	{
+		exit(runArchive(argc, argv, NUM_ITERATIONS));
+	}
+	if (argc > 1 && strcmp(argv[1], "--read-tile") == 0)
+	{
+		exit(runReadTile(argc, argv));
+	}
+	if (argc > 1 && strcmp(argv[1], "--zoom") == 0)
+	{
+		exit(runZoom(argc, argv, NUM_ITERATIONS));
+	}
+	if (argc > 1 && strcmp(argv[1], "--pyramid") == 0)
+	{
+		exit(runPyramid(argc, argv, NUM_ITERATIONS));
+	}
+	if (argc > 1 && strcmp(argv[1], "--autotune") == 0)
+	{
+		exit(runAutotune(argc, argv, NUM_ITERATIONS));
+	}
+
 	long windowWidth, windowHeight, numberOfThreads;
 	double planeWidth, planeHeight, centerX, centerY;
 	double complex C;
@@ -71,54 +200,256 @@ int main (int argc, char *argv[])
 		exit(result);
 	}
 
+	RenderOptions options;
+	result = getOptions(argc, argv, 10, &options);
+
+	if (result)
+	{
+		exit(result);
+	}
+
+	/* Whatever was left to "auto" comes from this machine's profile, if
+	   --autotune was ever run. */
+	TuneProfile profile;
+	bool tuned = readTuneProfile(AUTOTUNE_PROFILE_FILE, &profile);
+
+	if (numberOfThreads == AUTO_THREADS)
+	{
+		numberOfThreads = tuned ? profile.numberOfThreads : SDL_GetCPUCount();
+	}
+	if (options.kernel == KERNEL_AUTO)
+	{
+		options.kernel = tuned ? profile.kernel : KERNEL_SCALAR;
+	}
+	if (options.tileColumns == 0 && tuned)
+	{
+		options.tileColumns = profile.tileColumns;
+	}
+
+
+	if (options.renderer == RENDERER_INVERSE && 
+		(!inverseIterationSupports(options.map) || 
+		 options.coloring != COLOR_ESCAPE_TIME))
+	{
+		fprintf(stderr, "The miim renderer only supports the maps z2 to z8 "
+				"with coloring by escape time.\n");
+
+		exit(UNKNOWN_OPTION_FAIL);
+	}
+
+	/* Checkpoints save finished columns, which inverse iteration does not
+	   produce, so checkpointed renders always use escape time. */
+	if ((options.checkpointFile != NULL || options.resume) &&
+		(options.outputFile == NULL || options.checkpointFile == NULL ||
+		 options.renderer == RENDERER_INVERSE))
+	{
+		fprintf(stderr, "--checkpoint and --resume need --output and the "
+				"escape-time renderer, and --resume needs --checkpoint.\n");
+
+		exit(UNKNOWN_OPTION_FAIL);
+	}
+	if (options.checkpointFile != NULL)
+	{
+		options.renderer = RENDERER_ESCAPE_TIME;
+	}
+
+	/* Frames with a budget are computed tile by tile at several resolutions,
+	   which only escape time does. */
+	if (options.frameBudget > 0 &&
+		(options.outputFile != NULL || options.coloring != COLOR_ESCAPE_TIME ||
+		 options.renderer == RENDERER_INVERSE))
+	{
+		fprintf(stderr, "--frame-budget needs a window, the escape-time "
+				"renderer and coloring by escape time.\n");
+
+		exit(UNKNOWN_OPTION_FAIL);
+	}
+	if (options.frameBudget > 0)
+	{
+		options.renderer = RENDERER_ESCAPE_TIME;
+	}
+
 
 	/*** Calculate the color map through determining the Julia set. ***/
 	SDL_Color **colorMap = newColorMap(windowWidth, windowHeight);
 
-	SDL_Thread *threadList[numberOfThreads];
+	/* Keep the orbits of the window so that deepening and going back to an
+	   unfinished view can continue them. */
+	OrbitState **orbitMap = NULL;
+
+	if (options.outputFile == NULL && options.coloring == COLOR_ESCAPE_TIME &&
+		options.frameBudget == 0)
+	{
+		orbitMap = newOrbitMap(windowWidth, windowHeight);
+	}
+
 	ThreadData dataList[numberOfThreads];
 
+	/* Pinned threads each take chunks of at least a huge page, so that the
+	   pages they write to are not shared with threads on other sockets.
+	   Otherwise the threads take tiles of the size that was asked for or
+	   tuned, or else every numberOfThreads-th column, or tiles of
+	   TILE_COLUMNS columns when the image is shown in a window. */
+	long chunkColumns = 1;
+
+	if (options.pinning != PIN_NONE)
+	{
+		long columnSize = sizeof(SDL_Color) * windowHeight;
+
+		chunkColumns = (HUGE_PAGE_SIZE + columnSize - 1) / columnSize;
+	}
+	else if (options.tileColumns > 0)
+	{
+		chunkColumns = options.tileColumns;
+	}
+	else if (options.outputFile == NULL)
+	{
+		chunkColumns = TILE_COLUMNS;
+	}
+
 	/* Define the data packets that will be passed to each new thread.
 	   Do this before starting the timer so that it doesn't influence the 
 	   measured processing time. */
 	for (int threadID = 0; threadID < numberOfThreads; threadID++)
 	{
 		
-		dataList[threadID].centerX = centerX;
-		dataList[threadID].centerY = centerY;
-		dataList[threadID].planeWidth = planeWidth;
-		dataList[threadID].planeHeight = planeHeight;
-		dataList[threadID].C = C;
-		dataList[threadID].windowWidth = windowWidth;
-		dataList[threadID].windowHeight = windowHeight;
+		dataList[threadID].params.centerX = centerX;
+		dataList[threadID].params.centerY = centerY;
+		dataList[threadID].params.planeWidth = planeWidth;
+		dataList[threadID].params.planeHeight = planeHeight;
+		dataList[threadID].params.C = C;
+		dataList[threadID].params.windowWidth = windowWidth;
+		dataList[threadID].params.windowHeight = windowHeight;
+		dataList[threadID].params.numIterations = NUM_ITERATIONS;
+		dataList[threadID].params.map = options.map;
+		dataList[threadID].params.coloring = options.coloring;
+		dataList[threadID].params.renderer = RENDERER_ESCAPE_TIME;
+		dataList[threadID].params.kernel = options.kernel;
 		dataList[threadID].threadID = threadID;
 		dataList[threadID].numberOfThreads = (int)numberOfThreads;
-		dataList[threadID].numIterations = NUM_ITERATIONS;
+		dataList[threadID].pinning = options.pinning;
+		dataList[threadID].chunkColumns = chunkColumns;
 		dataList[threadID].colorMapPtr = &colorMap;
+		dataList[threadID].orbitMapPtr = &orbitMap;
+		dataList[threadID].tiles = NULL;
+		dataList[threadID].generation = NULL;
+		dataList[threadID].renderGeneration = 0;
+		dataList[threadID].finishedColumns = NULL;
 	}
 
-	Uint32 startTime = SDL_GetTicks();
+	/* Decide between escape time and inverse iteration once, as the choice
+	   only depends on the map and C. */
+	JuliaRenderer algorithm = chooseJuliaRenderer(options.renderer, 
+												  &dataList[0].params);
 
-		/* Create the number of threads specified by the user, and divide the 
-		   work up so that each thread fills in the same number of columns in 
-		   the color map. */
 	for (int threadID = 0; threadID < numberOfThreads; threadID++)
 	{
-		/* Make a new thread and pass it the appropriate data packet. */
-		threadList[threadID] = SDL_CreateThread( partialFill, "Current Thread",
-												(void*)&(dataList[threadID]) );
+		dataList[threadID].params.renderer = algorithm;
 	}
 
-		/* Wait for each thread to finish before drawing the Julia set. */
-	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+
+	/*** If an output file was given, write the image there instead of
+		 opening a window. ***/
+	if (options.outputFile != NULL)
 	{
-		SDL_WaitThread(threadList[threadID], NULL);
-	}
+		bool png = isPngFile(options.outputFile);
+		bool written;
+
+		/* PNG images are computed and compressed strip by strip in one pass,
+		   so compressing a strip overlaps with computing the others. This
+		   needs the escape-time renderer and no checkpoint, which both work
+		   on columns instead of strips. */
+		if (png && options.checkpointFile == NULL && 
+			algorithm != RENDERER_INVERSE)
+		{
+			Uint32 startTime = SDL_GetTicks();
+
+			written = writePng(options.outputFile, &dataList[0].params, 
+							   colorMap, true, options.pinning, 
+							   numberOfThreads);
+
+			printf("Processing and compression time: %dms\n", 
+				   SDL_GetTicks() - startTime);
+		}
+		else
+		{
+			/* Save finished chunks as the render goes, and skip the columns
+			   that an interrupted render already saved. */
+			Checkpoint checkpoint;
+			bool *finishedColumns = NULL;
+
+			if (options.checkpointFile != NULL)
+			{
+				finishedColumns = (bool*)calloc(windowWidth, sizeof(bool));
+
+				if (finishedColumns == NULL)
+				{
+					fprintf(stderr, "Not enough memory to keep track of the "
+							"finished columns.\n");
 
-	Uint32 endTime = SDL_GetTicks();
+					exit(FAILURE);
+				}
 
-	/*** Print out how long processing took with the given number of threads. ***/
-	printf("Processing time: %dms\n", endTime - startTime);
+				result = openCheckpoint(&checkpoint, options.checkpointFile, 
+										&dataList[0].params, colorMap, 
+										finishedColumns, 
+										(windowWidth + chunkColumns - 1) / 
+										chunkColumns, options.resume, 
+										options.checkpointInterval);
+
+				if (result)
+				{
+					exit(result);
+				}
+
+				for (int threadID = 0; threadID < numberOfThreads; threadID++)
+				{
+					dataList[threadID].tiles = checkpoint.tiles;
+					dataList[threadID].finishedColumns = finishedColumns;
+				}
+			}
+
+			Uint32 processingTime = runThreads(dataList, numberOfThreads);
+
+			/* Print out how long processing took with the given number of 
+			   threads. */
+			printf("Processing time: %dms\n", processingTime);
+
+			if (options.checkpointFile != NULL)
+			{
+				if (!closeCheckpoint(&checkpoint))
+				{
+					fprintf(stderr, "Could not write '%s'.\n", 
+							options.checkpointFile);
+				}
+
+				free(finishedColumns);
+			}
+
+			if (png)
+			{
+				written = writePng(options.outputFile, &dataList[0].params, 
+								   colorMap, false, options.pinning, 
+								   numberOfThreads);
+			}
+			else
+			{
+				written = writeColorMap(options.outputFile, colorMap, 
+										windowWidth, windowHeight);
+			}
+		}
+
+		freeColorMap(colorMap, windowWidth, windowHeight);
+
+		if (!written)
+		{
+			fprintf(stderr, "Could not write '%s'.\n", options.outputFile);
+
+			exit(FAILURE);
+		}
+
+		exit(SUCCESS);
+	}
 
 
 	/*** Initialize SDL. ***/
@@ -133,13 +464,17 @@ int main (int argc, char *argv[])
 		exit(FAILURE);
 	}
 
-	/*** Print the color map to the window. ***/
-	drawJuliaSet(colorMap, renderer, windowWidth, windowHeight);
+	/*** Let the user explore the Julia set until they close the window,
+		 then clean up SDL and exit. ***/ 
+	int command = runViewer(dataList, numberOfThreads, renderer,
+							options.frameBudget);
 
-	/*** Wait for the user to close the window, then clean up SDL and exit. ***/ 
-	result = waitForClose();
+	if (orbitMap != NULL)
+	{
+		freeOrbitMap(orbitMap, windowWidth, windowHeight);
+	}
 
-	if (result)
+	if (command == COMMAND_ERROR)
 	{
 		fprintf(stderr, "Error while waiting for user to close window.\n");
 
@@ -0,0 +1,560 @@
+/**
+@file Pyramid.c
+@author Rob Thomas
+@brief Contains functions for exporting a Julia set image as a Deep Zoom tile
+pyramid, in which every level is half the size of the one above it.
+*/
+
+/* mkdir() is POSIX, which strict C99 hides. */
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L
+#define PYRAMID_MKDIR
+#endif
+
+#include <complex.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#ifdef PYRAMID_MKDIR
+#include <sys/stat.h>
+#else
+#include <direct.h>
+#endif
+
+#include "Drawing.h"
+#include "HelperFunctions.h"
+#include "JuliaSet.h"
+#include "PngWriter.h"
+
+#include "Pyramid.h"
+
+
+/**
+@def PYRAMID_ARGS
+@brief The number of command line arguments (including the program name and
+--pyramid) that runPyramid() requires.
+*/
+#define PYRAMID_ARGS 12
+
+/**
+@def PYRAMID_FILE_NAME_SIZE
+@brief The size of the buffers that hold the file names of a pyramid.
+*/
+#define PYRAMID_FILE_NAME_SIZE 1024
+
+
+/**
+@fn makeDirectory
+@brief Creates a directory unless it exists already.
+@param name The name of the directory.
+@return true if the directory exists now, false otherwise.
+*/
+static bool makeDirectory (const char *name)
+{
+#ifdef PYRAMID_MKDIR
+	return mkdir(name, 0755) == 0 || errno == EEXIST;
+#else
+	return _mkdir(name) == 0 || errno == EEXIST;
+#endif
+}
+
+/**
+@fn shrinkStages
+@brief Works out the stage of a pixel of a smaller level from the stages of
+the pixels it covers: in the set if more than half of them are, and the
+rounded average of the escaped ones otherwise.
+@param stages The stages of the pixels covered.
+@param numStages The number of pixels covered, from 1 to 4.
+@return The stage of the pixel.
+*/
+static Sint32 shrinkStages (const Sint32 *stages, int numStages)
+{
+	long sum = 0;
+	int escaped = 0;
+
+	for (int i = 0; i < numStages; i++)
+	{
+		if (stages[i] != JULIA_IN_SET)
+		{
+			sum += stages[i];
+			escaped++;
+		}
+	}
+
+	if (2 * escaped < numStages)
+	{
+		return JULIA_IN_SET;
+	}
+
+	return (Sint32)((sum + escaped / 2) / escaped);
+}
+
+/**
+@fn shrinkTile
+@brief Shrinks a tile of the current band of a level into the band of the
+level below, which it fills half of in each direction.
+@param pyramid The pyramid.
+@param level The level of the tile. Not 0.
+@param x0 The first column of the tile.
+@param x1 One past the last column of the tile.
+*/
+static void shrinkTile (Pyramid *pyramid, int level, long x0, long x1)
+{
+	PyramidLevel *from = &pyramid->levels[level];
+	PyramidLevel *to = &pyramid->levels[level - 1];
+
+	/* Odd bands go to the bottom half of the band below. */
+	long offset = (from->band % 2) * (PYRAMID_TILE_SIZE / 2);
+
+	for (long y = 0; y < from->rows; y += 2)
+	{
+		const Sint32 *row = from->counts + y * from->width;
+		const Sint32 *below = (y + 1 < from->rows) ? row + from->width : NULL;
+		Sint32 *target = to->counts + (offset + y / 2) * to->width;
+
+		for (long x = x0; x < x1; x += 2)
+		{
+			Sint32 stages[4];
+			int numStages = 0;
+
+			stages[numStages++] = row[x];
+
+			if (x + 1 < x1)
+			{
+				stages[numStages++] = row[x + 1];
+			}
+			if (below != NULL)
+			{
+				stages[numStages++] = below[x];
+
+				if (x + 1 < x1)
+				{
+					stages[numStages++] = below[x + 1];
+				}
+			}
+
+			target[x / 2] = shrinkStages(stages, numStages);
+		}
+	}
+}
+
+/**
+@fn writePyramidTile
+@brief Writes one tile of the current band of the current level, computing
+it first if the level is the finest, and shrinks it into the level below.
+@param pyramid The pyramid.
+@param column The column of the tile.
+@param colorMap A PYRAMID_TILE_SIZE square color map to color the tile in.
+@return true if the tile was written, false otherwise.
+*/
+static bool writePyramidTile (Pyramid *pyramid, long column,
+							  SDL_Color **colorMap)
+{
+	int level = pyramid->level;
+	PyramidLevel *l = &pyramid->levels[level];
+	long x0 = column * PYRAMID_TILE_SIZE;
+	long x1 = (x0 + PYRAMID_TILE_SIZE < l->width) ? x0 + PYRAMID_TILE_SIZE :
+			  l->width;
+
+	if (level == pyramid->numLevels - 1)
+	{
+		long y0 = l->band * PYRAMID_TILE_SIZE;
+
+		fillJuliaCounts(&pyramid->params, l->counts + x0, l->width, x0, y0,
+						x1, y0 + l->rows);
+	}
+
+	/*** Color the tile and write it. ***/
+	for (long x = x0; x < x1; x++)
+	{
+		for (long y = 0; y < l->rows; y++)
+		{
+			Sint32 stage = l->counts[y * l->width + x];
+
+			colorMap[x - x0][y] = (stage == JULIA_IN_SET) ? colorInSet() :
+								  colorOutOfSet(stage);
+		}
+	}
+
+	JuliaParams tile = pyramid->params;
+	char fileName[PYRAMID_FILE_NAME_SIZE];
+
+	tile.windowWidth = x1 - x0;
+	tile.windowHeight = l->rows;
+	snprintf(fileName, sizeof(fileName), "%s_files/%d/%ld_%ld.png",
+			 pyramid->name, level, column, l->band);
+
+	bool written = writePng(fileName, &tile, colorMap, false, PIN_NONE, 1);
+
+	if (!written)
+	{
+		fprintf(stderr, "Could not write '%s'.\n", fileName);
+	}
+
+	/*** Pass it on to the level below. ***/
+	if (level > 0)
+	{
+		shrinkTile(pyramid, level, x0, x1);
+	}
+
+	return written;
+}
+
+/**
+@fn partialPyramid
+@brief Writes tiles of the current band of the current level until none are
+left, computing them first if the level is the finest, and shrinks each one
+into the level below.
+@param data A void pointer to be cast into a PyramidData struct.
+*/
+int partialPyramid (void *data)
+{
+	PyramidData *d = (PyramidData*)data;
+	Pyramid *pyramid = d->pyramid;
+	PyramidLevel *level = &pyramid->levels[pyramid->level];
+	long tilesAcross = (level->width + PYRAMID_TILE_SIZE - 1) /
+					   PYRAMID_TILE_SIZE;
+
+	while (true)
+	{
+		long column = SDL_AtomicAdd(&pyramid->nextTile, 1);
+
+		if (column >= tilesAcross)
+		{
+			break;
+		}
+
+		if (!writePyramidTile(pyramid, column, d->colorMap))
+		{
+			SDL_AtomicSet(&pyramid->failed, 1);
+		}
+	}
+
+	return 0;
+}
+
+/**
+@fn writeBand
+@brief Writes the current band of a level in one new thread per data packet
+(or fewer if the band has fewer tiles) and waits for all of them to finish.
+@param pyramid The pyramid.
+@param level The level.
+@param dataList The data packet of each thread.
+@param numberOfThreads The number of threads to run at most.
+@return true if every tile was written, false otherwise.
+*/
+static bool writeBand (Pyramid *pyramid, int level, PyramidData dataList[],
+					   long numberOfThreads)
+{
+	long tilesAcross = (pyramid->levels[level].width + PYRAMID_TILE_SIZE - 1) /
+					   PYRAMID_TILE_SIZE;
+	long numThreads = (tilesAcross < numberOfThreads) ? tilesAcross :
+					  numberOfThreads;
+	SDL_Thread *threadList[numThreads];
+
+	pyramid->level = level;
+	SDL_AtomicSet(&pyramid->nextTile, 0);
+
+	for (int threadID = 0; threadID < numThreads; threadID++)
+	{
+		threadList[threadID] = SDL_CreateThread(partialPyramid,
+												"Pyramid Thread",
+												(void*)&(dataList[threadID]));
+	}
+
+	for (int threadID = 0; threadID < numThreads; threadID++)
+	{
+		SDL_WaitThread(threadList[threadID], NULL);
+	}
+
+	return SDL_AtomicGet(&pyramid->failed) == 0;
+}
+
+/**
+@fn writeDescriptor
+@brief Writes the .dzi file that describes a pyramid to Deep Zoom viewers.
+@param pyramid The pyramid.
+@return true if the file was written, false otherwise.
+*/
+static bool writeDescriptor (const Pyramid *pyramid)
+{
+	char fileName[PYRAMID_FILE_NAME_SIZE];
+
+	snprintf(fileName, sizeof(fileName), "%s.dzi", pyramid->name);
+
+	FILE *file = fopen(fileName, "w");
+
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	fprintf(file, "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" "
+			"Format=\"png\" Overlap=\"0\" TileSize=\"%d\">\n",
+			PYRAMID_TILE_SIZE);
+	fprintf(file, "  <Size Width=\"%ld\" Height=\"%ld\"/>\n",
+			pyramid->params.windowWidth, pyramid->params.windowHeight);
+	fprintf(file, "</Image>\n");
+
+	bool written = !ferror(file);
+
+	return (fclose(file) == 0) && written;
+}
+
+/**
+@fn freePyramidLevels
+@brief Frees the levels of a pyramid.
+@param pyramid The pyramid.
+*/
+static void freePyramidLevels (Pyramid *pyramid)
+{
+	for (int level = 0; level < pyramid->numLevels; level++)
+	{
+		free(pyramid->levels[level].counts);
+	}
+
+	free(pyramid->levels);
+}
+
+/**
+@fn runPyramid
+@brief Renders a Julia set into a Deep Zoom tile pyramid.
+@details runPyramid() is called as
+	Project04_01 --pyramid windowWidth windowHeight planeWidth planeHeight
+						   centerX centerY a b numberOfThreads outputName
+						   [--map=NAME]
+with the same meaning as the arguments of main(), where windowWidth and
+windowHeight are the size of the finest level.
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if the pyramid was written.
+*/
+int runPyramid (int argc, char *argv[], int numIterations)
+{
+	/*** Read in command line arguments. ***/
+	if (argc < PYRAMID_ARGS)
+	{
+		fprintf(stderr, "Usage: %s --pyramid windowWidth windowHeight "
+				"planeWidth planeHeight centerX centerY a b numberOfThreads "
+				"outputName [--map=NAME]\n", argv[0]);
+
+		return INSUFFICIENT_ARGS_FAIL;
+	}
+
+	double values[9];
+
+	for (int i = 0; i < 9; i++)
+	{
+		char *endptr = NULL;
+
+		values[i] = strtod(argv[i + 2], &endptr);
+
+		if (endptr == argv[i + 2] || *endptr != '\0')
+		{
+			fprintf(stderr, "Non-number arg given. All args must be numbers.\n");
+
+			return ARG_NOT_A_NUMBER_FAIL;
+		}
+	}
+
+	long numberOfThreads = (long)values[8];
+
+	if (values[0] < 1 || values[1] < 1 || numberOfThreads <= 0)
+	{
+		fprintf(stderr, "Window size and number of threads must be greater "
+				"than 0.\n");
+
+		return ARG_BELOW_ONE_FAIL;
+	}
+
+	RenderOptions options;
+	int result = getOptions(argc, argv, PYRAMID_ARGS, &options);
+
+	if (result)
+	{
+		return result;
+	}
+	if (options.coloring != COLOR_ESCAPE_TIME ||
+		options.renderer == RENDERER_INVERSE)
+	{
+		fprintf(stderr, "Pyramids are shrunk in escape times, so they only "
+				"support the escape-time renderer.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+	if (options.kernel != KERNEL_AUTO || options.tileColumns != 0)
+	{
+		fprintf(stderr, "Pyramids are computed in their own tiles with the "
+				"scalar kernel, so they do not support --kernel or --tile.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+
+	/*** Describe the pyramid. ***/
+	Pyramid pyramid;
+
+	pyramid.params.windowWidth = (long)values[0];
+	pyramid.params.windowHeight = (long)values[1];
+	pyramid.params.planeWidth = values[2];
+	pyramid.params.planeHeight = values[3];
+	pyramid.params.centerX = values[4];
+	pyramid.params.centerY = values[5];
+	pyramid.params.C = values[6] + values[7] * I;
+	pyramid.params.numIterations = numIterations;
+	pyramid.params.map = options.map;
+	pyramid.params.coloring = COLOR_ESCAPE_TIME;
+	pyramid.params.renderer = RENDERER_ESCAPE_TIME;
+	pyramid.params.kernel = KERNEL_SCALAR;
+	pyramid.name = argv[11];
+	SDL_AtomicSet(&pyramid.failed, 0);
+
+	/* Level 0 is one pixel, and each level doubles the one below it until
+	   the finest one holds the whole image. */
+	long largest = (pyramid.params.windowWidth > pyramid.params.windowHeight) ?
+				   pyramid.params.windowWidth : pyramid.params.windowHeight;
+
+	pyramid.numLevels = 1;
+
+	while ((1L << (pyramid.numLevels - 1)) < largest)
+	{
+		pyramid.numLevels++;
+	}
+
+	pyramid.levels = (PyramidLevel*)calloc(pyramid.numLevels,
+										   sizeof(PyramidLevel));
+
+	bool allocated = (pyramid.levels != NULL);
+
+	for (int level = 0; allocated && level < pyramid.numLevels; level++)
+	{
+		PyramidLevel *l = &pyramid.levels[level];
+		int shift = pyramid.numLevels - 1 - level;
+
+		l->width = ((pyramid.params.windowWidth - 1) >> shift) + 1;
+		l->height = ((pyramid.params.windowHeight - 1) >> shift) + 1;
+		l->counts = (Sint32*)malloc(sizeof(Sint32) * PYRAMID_TILE_SIZE *
+									l->width);
+		allocated = (l->counts != NULL);
+	}
+
+	if (!allocated)
+	{
+		fprintf(stderr, "Not enough memory for the levels of the pyramid.\n");
+
+		if (pyramid.levels != NULL)
+		{
+			freePyramidLevels(&pyramid);
+		}
+
+		return PYRAMID_WRITE_FAIL;
+	}
+
+	/*** Set up the directories and the descriptor. ***/
+	char directory[PYRAMID_FILE_NAME_SIZE];
+	bool written = true;
+
+	snprintf(directory, sizeof(directory), "%s_files", pyramid.name);
+	written = makeDirectory(directory);
+
+	for (int level = 0; written && level < pyramid.numLevels; level++)
+	{
+		snprintf(directory, sizeof(directory), "%s_files/%d", pyramid.name,
+				 level);
+		written = makeDirectory(directory);
+	}
+
+	if (!written || !writeDescriptor(&pyramid))
+	{
+		fprintf(stderr, "Could not set up the pyramid '%s'.\n", pyramid.name);
+		freePyramidLevels(&pyramid);
+
+		return PYRAMID_WRITE_FAIL;
+	}
+
+	PyramidData dataList[numberOfThreads];
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		dataList[threadID].pyramid = &pyramid;
+		dataList[threadID].colorMap = newColorMap(PYRAMID_TILE_SIZE,
+												  PYRAMID_TILE_SIZE);
+	}
+
+	/*** Render the finest level band by band. Whenever the band of a level
+		 fills up, write it and pass it on to the level below. ***/
+	Uint32 startTime = SDL_GetTicks();
+	int finest = pyramid.numLevels - 1;
+	PyramidLevel *top = &pyramid.levels[finest];
+
+	for (long band = 0; written && band * PYRAMID_TILE_SIZE < top->height;
+		 band++)
+	{
+		long rows = top->height - band * PYRAMID_TILE_SIZE;
+
+		top->band = band;
+		top->rows = (rows < PYRAMID_TILE_SIZE) ? rows : PYRAMID_TILE_SIZE;
+
+		for (int level = finest; written; level--)
+		{
+			PyramidLevel *l = &pyramid.levels[level];
+
+			written = writeBand(&pyramid, level, dataList, numberOfThreads);
+
+			if (level == 0)
+			{
+				break;
+			}
+
+			PyramidLevel *below = &pyramid.levels[level - 1];
+
+			below->rows = (l->band % 2) * (PYRAMID_TILE_SIZE / 2) +
+						  (l->rows + 1) / 2;
+			l->band++;
+			l->rows = 0;
+
+			/* The band below waits for the next band of this level unless
+			   it is full or the last one. */
+			if (below->rows < PYRAMID_TILE_SIZE &&
+				below->band * PYRAMID_TILE_SIZE + below->rows < below->height)
+			{
+				break;
+			}
+		}
+	}
+
+	printf("Processing time: %dms\n", SDL_GetTicks() - startTime);
+
+	/* Compare the points computed with rendering every level on its own. */
+	long computed = top->width * top->height;
+	double perLevel = 0.0;
+	long numTiles = 0;
+
+	for (int level = 0; level < pyramid.numLevels; level++)
+	{
+		PyramidLevel *l = &pyramid.levels[level];
+
+		perLevel += (double)l->width * l->height;
+		numTiles += ((l->width + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE) *
+					((l->height + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE);
+	}
+
+	printf("%d levels, %ld tiles. Computed %ld points instead of %.0f "
+		   "(%.1fx fewer).\n", pyramid.numLevels, numTiles, computed,
+		   perLevel, perLevel / computed);
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		freeColorMap(dataList[threadID].colorMap, PYRAMID_TILE_SIZE,
+					 PYRAMID_TILE_SIZE);
+	}
+
+	freePyramidLevels(&pyramid);
+
+	return written ? GET_ARGS_SUCCEED : PYRAMID_WRITE_FAIL;
+}
@@ -0,0 +1,118 @@
+/**
+@file Pyramid.h
+@author Rob Thomas
+@brief Contains functions for exporting a Julia set image as a Deep Zoom tile
+pyramid, in which every level is half the size of the one above it.
+@details Only the finest level is computed. It is rendered one band of
+PYRAMID_TILE_SIZE rows at a time, and each tile of a band is written as soon
+as it is finished and then shrunk into the band of the level below, two rows
+of the band for every row of the smaller level. A level whose band is full is
+written and shrunk the same way, so every level only ever holds one band, and
+the memory used does not grow with the height of the image.
+
+Levels are shrunk in iteration counts, not in colors. A pixel of a smaller
+level is in the set if most of the (up to four) pixels it covers are, and
+otherwise gets the average escape time of those of them that escaped, so it
+is colored from the same palette as the rest of the image instead of a blend
+of two palette colors.
+
+The pyramid is written in the layout read by Deep Zoom viewers such as
+OpenSeadragon: outputName.dzi describes the image, and tile (column, row) of
+level L is outputName_files/L/column_row.png. Level 0 is a single pixel.
+*/
+
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "HelperFunctions.h"
+
+
+/**
+@def PYRAMID_WRITE_FAIL
+@brief Error code indicating that a pyramid could not be rendered or written
+to disk.
+*/
+#define PYRAMID_WRITE_FAIL 17
+
+/**
+@def PYRAMID_TILE_SIZE
+@brief The width and height (in pixels) of the tiles of a pyramid. Must be
+even.
+*/
+#define PYRAMID_TILE_SIZE 256
+
+
+/**
+@typedef PyramidLevel
+@brief The PyramidLevel struct holds the band of one level of a pyramid that
+is being filled: band is the row of tiles it belongs to, and rows the number
+of its rows that are filled so far. counts holds PYRAMID_TILE_SIZE rows of
+width stages (see JuliaSet.h), row after row.
+*/
+typedef struct PyramidLevel
+{
+	long width, height;
+	long band, rows;
+	Sint32 *counts;
+} PyramidLevel;
+
+/**
+@typedef Pyramid
+@brief The Pyramid struct describes a pyramid that is being written. Level
+numLevels - 1 is the finest; params describes it. Worker threads take the
+tiles of the current band of level from nextTile, and set failed if one of
+them cannot be written.
+*/
+typedef struct Pyramid
+{
+	JuliaParams params;
+	const char *name;
+	int numLevels;
+	PyramidLevel *levels;
+	int level;
+	SDL_atomic_t nextTile;
+	SDL_atomic_t failed;
+} Pyramid;
+
+/**
+@typedef PyramidData
+@brief The PyramidData struct is used for transmitting the pyramid to the
+threads that write it, with a PYRAMID_TILE_SIZE square color map of their own
+to color tiles in.
+*/
+typedef struct PyramidData
+{
+	Pyramid *pyramid;
+	SDL_Color **colorMap;
+} PyramidData;
+
+
+/**
+@fn partialPyramid
+@brief Writes tiles of the current band of the current level until none are
+left, computing them first if the level is the finest, and shrinks each one
+into the level below.
+@param data A void pointer to be cast into a PyramidData struct.
+*/
+int partialPyramid (void *data);
+
+/**
+@fn runPyramid
+@brief Renders a Julia set into a Deep Zoom tile pyramid.
+@details runPyramid() is called as
+	Project04_01 --pyramid windowWidth windowHeight planeWidth planeHeight
+						   centerX centerY a b numberOfThreads outputName
+						   [--map=NAME]
+with the same meaning as the arguments of main(), where windowWidth and
+windowHeight are the size of the finest level.
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if the pyramid was written.
+*/
+int runPyramid (int argc, char *argv[], int numIterations);
+
+#endif /* PYRAMID_H */
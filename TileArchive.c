@@ -0,0 +1,734 @@
+/**
+@file TileArchive.c
+@author Rob Thomas
+@brief Contains functions for storing the iteration counts of a Julia set image
+as a compressed tile archive, and for reading single tiles back out of it.
+*/
+
+/* mmap() is POSIX, which strict C99 hides. */
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L
+#define ARCHIVE_MMAP
+#endif
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#ifdef ARCHIVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Drawing.h"
+#include "HelperFunctions.h"
+#include "InverseIteration.h"
+#include "JuliaSet.h"
+
+#include "TileArchive.h"
+
+
+/**
+@def ARCHIVE_ARGS
+@brief The number of command line arguments (including the program name and
+--archive) that runArchive() requires.
+*/
+#define ARCHIVE_ARGS 13
+
+/**
+@def READ_TILE_ARGS
+@brief The number of command line arguments (including the program name and
+--read-tile) that runReadTile() requires.
+*/
+#define READ_TILE_ARGS 6
+
+
+/*** Tile compression. ***/
+
+/**
+@fn putVarint
+@brief Stores a number in as few bytes as possible, 7 bits per byte with the
+high bit set on every byte but the last.
+@param data Where the number is stored.
+@param value The number.
+@return The number of bytes used.
+*/
+static size_t putVarint (Uint8 *data, Uint32 value)
+{
+	size_t size = 0;
+
+	while (value >= 0x80)
+	{
+		data[size++] = (Uint8)(value | 0x80);
+		value >>= 7;
+	}
+
+	data[size++] = (Uint8)value;
+
+	return size;
+}
+
+/**
+@fn getVarint
+@brief Reads a number stored by putVarint().
+@param data The data.
+@param size The size of the data.
+@param position Pointer to the position of the number in the data, which is
+moved past it.
+@param value Pointer to where the number will be stored.
+@return true if a whole number was read, false if the data ended first.
+*/
+static bool getVarint (const Uint8 *data, size_t size, size_t *position,
+					   Uint32 *value)
+{
+	*value = 0;
+
+	for (int shift = 0; shift < 7 * MAX_VARINT_BYTES; shift += 7)
+	{
+		if (*position >= size)
+		{
+			return false;
+		}
+
+		Uint8 byte = data[(*position)++];
+
+		*value |= (Uint32)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+@fn compressTile
+@brief Compresses the stages of one tile.
+@param counts The stages of the tile in row-major order.
+@param numCounts The number of stages.
+@param data Where the compressed tile is stored. It must have room for
+2 * MAX_VARINT_BYTES * numCounts bytes.
+@return The size (in bytes) of the compressed tile.
+*/
+size_t compressTile (const Sint32 *counts, long numCounts, Uint8 *data)
+{
+	size_t size = 0;
+	Sint32 previous = 0;
+	long i = 0;
+
+	while (i < numCounts)
+	{
+		Uint32 delta = (Uint32)counts[i] - (Uint32)previous;
+		long run = 1;
+
+		previous = counts[i];
+
+		while (i + run < numCounts &&
+			   (Uint32)counts[i + run] - (Uint32)previous == delta)
+		{
+			previous = counts[i + run];
+			run++;
+		}
+
+		/* Zigzag encoding keeps small negative differences small. */
+		Uint32 zigzag = (delta << 1) ^ ((delta & 0x80000000u) ? 0xFFFFFFFFu : 0);
+
+		size += putVarint(data + size, zigzag);
+		size += putVarint(data + size, (Uint32)(run - 1));
+		i += run;
+	}
+
+	return size;
+}
+
+/**
+@fn decompressTile
+@brief Restores the stages of one tile from its compressed data.
+@param data The compressed tile.
+@param size The size (in bytes) of the compressed tile.
+@param counts Where the stages are stored.
+@param numCounts The number of stages in the tile.
+@return true if the data held exactly numCounts stages, false otherwise.
+*/
+bool decompressTile (const Uint8 *data, size_t size, Sint32 *counts,
+					 long numCounts)
+{
+	size_t position = 0;
+	Uint32 previous = 0;
+	long i = 0;
+
+	while (position < size)
+	{
+		Uint32 zigzag, run;
+
+		if (!getVarint(data, size, &position, &zigzag) ||
+			!getVarint(data, size, &position, &run) ||
+			(long)run >= numCounts - i)
+		{
+			return false;
+		}
+
+		Uint32 delta = (zigzag >> 1) ^ ((zigzag & 1) ? 0xFFFFFFFFu : 0);
+
+		for (long j = 0; j <= (long)run; j++)
+		{
+			previous += delta;
+			counts[i++] = (Sint32)previous;
+		}
+	}
+
+	return (i == numCounts);
+}
+
+
+/*** Writing archives. ***/
+
+/**
+@fn writeArchiveHeader
+@brief Writes the header of a tile archive and reserves room for its index.
+@param archive The archive being written.
+@return true if the header was written, false otherwise.
+*/
+static bool writeArchiveHeader (TileArchive *archive)
+{
+	Uint8 header[ARCHIVE_HEADER_SIZE];
+	const JuliaParams *p = &archive->params;
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, ARCHIVE_MAGIC, 4);
+	putU32(header + 4, 1);
+	putU32(header + 8, (Uint32)p->windowWidth);
+	putU32(header + 12, (Uint32)p->windowHeight);
+	putU32(header + 16, (Uint32)archive->tileSize);
+	putU32(header + 20, (Uint32)archive->tilesAcross);
+	putU32(header + 24, (Uint32)archive->tilesDown);
+	putU32(header + 28, (Uint32)p->numIterations);
+	putU32(header + 32, (Uint32)p->map);
+	putDouble(header + 40, p->centerX);
+	putDouble(header + 48, p->centerY);
+	putDouble(header + 56, p->planeWidth);
+	putDouble(header + 64, p->planeHeight);
+	putDouble(header + 72, creal(p->C));
+	putDouble(header + 80, cimag(p->C));
+
+	return (fwrite(header, 1, sizeof(header), archive->file) == sizeof(header));
+}
+
+/**
+@fn writeArchiveIndex
+@brief Writes the index of a tile archive once every tile has been stored.
+@param archive The archive being written.
+@return true if the index was written, false otherwise.
+*/
+static bool writeArchiveIndex (TileArchive *archive)
+{
+	long numTiles = archive->tilesAcross * archive->tilesDown;
+
+	if (fseek(archive->file, ARCHIVE_HEADER_SIZE, SEEK_SET) != 0)
+	{
+		return false;
+	}
+
+	for (long tile = 0; tile < numTiles; tile++)
+	{
+		Uint8 entry[ARCHIVE_INDEX_ENTRY_SIZE];
+
+		memset(entry, 0, sizeof(entry));
+		putU64(entry, archive->index[tile].offset);
+		putU32(entry + 8, archive->index[tile].size);
+
+		if (fwrite(entry, 1, sizeof(entry), archive->file) != sizeof(entry))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+@fn archiveWorker
+@brief Computes, compresses and stores tiles of an archive until none are
+left.
+@param data A void pointer to be cast into a TileArchive struct.
+*/
+int archiveWorker (void *data)
+{
+	TileArchive *archive = (TileArchive*)data;
+	long tileSize = archive->tileSize;
+	long numTiles = archive->tilesAcross * archive->tilesDown;
+
+	Sint32 *counts = (Sint32*)malloc(sizeof(Sint32) * tileSize * tileSize);
+	Uint8 *compressed = (Uint8*)malloc(2 * MAX_VARINT_BYTES * tileSize *
+									   tileSize);
+
+	if (counts == NULL || compressed == NULL)
+	{
+		free(counts);
+		free(compressed);
+		archive->failed = true;
+
+		return 0;
+	}
+
+	long tile;
+
+	while ((tile = SDL_AtomicAdd(&archive->nextTile, 1)) < numTiles)
+	{
+		long x0 = (tile % archive->tilesAcross) * tileSize;
+		long y0 = (tile / archive->tilesAcross) * tileSize;
+		long x1 = (x0 + tileSize < archive->params.windowWidth) ?
+				  x0 + tileSize : archive->params.windowWidth;
+		long y1 = (y0 + tileSize < archive->params.windowHeight) ?
+				  y0 + tileSize : archive->params.windowHeight;
+
+		/* Compute and compress the tile without holding the lock. */
+		fillJuliaCounts(&archive->params, counts, x1 - x0, x0, y0, x1, y1);
+
+		size_t size = compressTile(counts, (x1 - x0) * (y1 - y0), compressed);
+
+		/* Append the tile to the file. */
+		SDL_LockMutex(archive->lock);
+
+		Uint64 offset = archive->nextOffset;
+
+		if (fseek(archive->file, (long)offset, SEEK_SET) != 0 ||
+			fwrite(compressed, 1, size, archive->file) != size)
+		{
+			archive->failed = true;
+		}
+
+		archive->index[tile].offset = offset;
+		archive->index[tile].size = (Uint32)size;
+		archive->nextOffset += size;
+
+		SDL_UnlockMutex(archive->lock);
+	}
+
+	free(counts);
+	free(compressed);
+
+	return 0;
+}
+
+/**
+@fn runArchive
+@brief Renders a Julia set into a tile archive.
+@details runArchive() is called as
+	Project04_01 --archive windowWidth windowHeight planeWidth planeHeight
+						   centerX centerY a b tileSize numberOfThreads
+						   outputFile [--map=NAME]
+with the same meaning as the arguments of main().
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if the archive was written.
+*/
+int runArchive (int argc, char *argv[], int numIterations)
+{
+	/*** Read in command line arguments. ***/
+	if (argc < ARCHIVE_ARGS)
+	{
+		fprintf(stderr, "Usage: %s --archive windowWidth windowHeight "
+				"planeWidth planeHeight centerX centerY a b tileSize "
+				"numberOfThreads outputFile [--map=NAME]\n", argv[0]);
+
+		return INSUFFICIENT_ARGS_FAIL;
+	}
+
+	double values[10];
+
+	for (int i = 0; i < 10; i++)
+	{
+		char *endptr = NULL;
+
+		values[i] = strtod(argv[i + 2], &endptr);
+
+		if (endptr == argv[i + 2] || *endptr != '\0')
+		{
+			fprintf(stderr, "Non-number arg given. All args must be numbers.\n");
+
+			return ARG_NOT_A_NUMBER_FAIL;
+		}
+	}
+
+	long tileSize = (long)values[8];
+	long numberOfThreads = (long)values[9];
+
+	if (values[0] < 1 || values[1] < 1 || tileSize <= 0 ||
+		numberOfThreads <= 0)
+	{
+		fprintf(stderr, "Window size, tile size and number of threads must be "
+				"greater than 0.\n");
+
+		return ARG_BELOW_ONE_FAIL;
+	}
+
+	RenderOptions options;
+	int result = getOptions(argc, argv, ARCHIVE_ARGS, &options);
+
+	if (result)
+	{
+		return result;
+	}
+	if (options.coloring != COLOR_ESCAPE_TIME ||
+		options.renderer == RENDERER_INVERSE)
+	{
+		fprintf(stderr, "Tile archives store escape times, so they only "
+				"support the escape-time renderer.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+	if (options.kernel != KERNEL_AUTO || options.tileColumns != 0)
+	{
+		fprintf(stderr, "Tile archives are computed in their own tiles with the "
+				"scalar kernel, so they do not support --kernel or --tile.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+
+	/*** Describe the archive. ***/
+	TileArchive archive;
+
+	archive.params.windowWidth = (long)values[0];
+	archive.params.windowHeight = (long)values[1];
+	archive.params.planeWidth = values[2];
+	archive.params.planeHeight = values[3];
+	archive.params.centerX = values[4];
+	archive.params.centerY = values[5];
+	archive.params.C = values[6] + values[7] * I;
+	archive.params.numIterations = numIterations;
+	archive.params.map = options.map;
+	archive.params.coloring = COLOR_ESCAPE_TIME;
+	archive.params.renderer = RENDERER_ESCAPE_TIME;
+	archive.params.kernel = KERNEL_SCALAR;
+	archive.tileSize = tileSize;
+	archive.tilesAcross = (archive.params.windowWidth + tileSize - 1) / tileSize;
+	archive.tilesDown = (archive.params.windowHeight + tileSize - 1) / tileSize;
+	archive.failed = false;
+	SDL_AtomicSet(&archive.nextTile, 0);
+
+	long numTiles = archive.tilesAcross * archive.tilesDown;
+
+	archive.nextOffset = ARCHIVE_HEADER_SIZE +
+						 (Uint64)numTiles * ARCHIVE_INDEX_ENTRY_SIZE;
+	archive.index = (TileIndexEntry*)calloc(numTiles, sizeof(TileIndexEntry));
+	archive.lock = SDL_CreateMutex();
+	archive.file = fopen(argv[12], "wb");
+
+	if (archive.index == NULL || archive.lock == NULL ||
+		archive.file == NULL || !writeArchiveHeader(&archive))
+	{
+		fprintf(stderr, "Could not write '%s'.\n", argv[12]);
+
+		if (archive.file != NULL)
+		{
+			fclose(archive.file);
+		}
+		if (archive.lock != NULL)
+		{
+			SDL_DestroyMutex(archive.lock);
+		}
+		free(archive.index);
+
+		return ARCHIVE_WRITE_FAIL;
+	}
+
+	/*** Compute and store the tiles. ***/
+	SDL_Thread *threadList[numberOfThreads];
+	Uint32 startTime = SDL_GetTicks();
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		threadList[threadID] = SDL_CreateThread(archiveWorker, "Archive Thread",
+												(void*)&archive);
+	}
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		SDL_WaitThread(threadList[threadID], NULL);
+	}
+
+	bool written = !archive.failed && writeArchiveIndex(&archive);
+
+	written = (fclose(archive.file) == 0) && written;
+
+	printf("Processing time: %dms\n", SDL_GetTicks() - startTime);
+
+	SDL_DestroyMutex(archive.lock);
+	free(archive.index);
+
+	if (!written)
+	{
+		fprintf(stderr, "Could not write '%s'.\n", argv[12]);
+
+		return ARCHIVE_WRITE_FAIL;
+	}
+
+	Uint64 rawSize = (Uint64)archive.params.windowWidth *
+					 archive.params.windowHeight * sizeof(Sint32);
+
+	printf("Wrote %ld tiles in %llu bytes (%.1f%% of the raw counts).\n",
+		   numTiles, (unsigned long long)archive.nextOffset,
+		   100.0 * archive.nextOffset / rawSize);
+
+	return GET_ARGS_SUCCEED;
+}
+
+
+/*** Reading archives. ***/
+
+/**
+@fn decodeArchiveTile
+@brief Reads one tile out of the bytes of a tile archive.
+@param bytes The start of the archive.
+@param fileSize The size (in bytes) of the archive.
+@param column The column of the tile.
+@param row The row of the tile.
+@param params Pointer to where the description of the whole image will be
+stored.
+@param counts Pointer to where the dynamically allocated stages of the tile
+will be stored.
+@param width Pointer to where the width of the tile will be stored.
+@param height Pointer to where the height of the tile will be stored.
+@return true if the tile was read, false otherwise.
+*/
+static bool decodeArchiveTile (const Uint8 *bytes, Uint64 fileSize,
+							   long column, long row, JuliaParams *params,
+							   Sint32 **counts, long *width, long *height)
+{
+	if (fileSize < ARCHIVE_HEADER_SIZE || memcmp(bytes, ARCHIVE_MAGIC, 4) != 0)
+	{
+		return false;
+	}
+
+	long tileSize = getU32(bytes + 16);
+	long tilesAcross = getU32(bytes + 20);
+	long tilesDown = getU32(bytes + 24);
+
+	params->windowWidth = getU32(bytes + 8);
+	params->windowHeight = getU32(bytes + 12);
+	params->numIterations = (int)getU32(bytes + 28);
+	params->map = (JuliaMap)getU32(bytes + 32);
+	params->centerX = getDouble(bytes + 40);
+	params->centerY = getDouble(bytes + 48);
+	params->planeWidth = getDouble(bytes + 56);
+	params->planeHeight = getDouble(bytes + 64);
+	params->C = getDouble(bytes + 72) + getDouble(bytes + 80) * I;
+	params->coloring = COLOR_ESCAPE_TIME;
+	params->renderer = RENDERER_ESCAPE_TIME;
+	params->kernel = KERNEL_SCALAR;
+
+	if (column < 0 || column >= tilesAcross || row < 0 || row >= tilesDown ||
+		ARCHIVE_HEADER_SIZE + (Uint64)tilesAcross * tilesDown *
+		ARCHIVE_INDEX_ENTRY_SIZE > fileSize)
+	{
+		return false;
+	}
+
+	/*** Look the tile up in the index. ***/
+	const Uint8 *entry = bytes + ARCHIVE_HEADER_SIZE +
+						 (row * tilesAcross + column) *
+						 ARCHIVE_INDEX_ENTRY_SIZE;
+	Uint64 offset = getU64(entry);
+	Uint32 size = getU32(entry + 8);
+
+	if (offset > fileSize || size > fileSize - offset)
+	{
+		return false;
+	}
+
+	long x0 = column * tileSize;
+	long y0 = row * tileSize;
+
+	*width = (x0 + tileSize < params->windowWidth) ? tileSize :
+			 params->windowWidth - x0;
+	*height = (y0 + tileSize < params->windowHeight) ? tileSize :
+			  params->windowHeight - y0;
+	*counts = (Sint32*)malloc(sizeof(Sint32) * *width * *height);
+
+	if (*counts == NULL)
+	{
+		return false;
+	}
+
+	if (!decompressTile(bytes + offset, size, *counts, *width * *height))
+	{
+		free(*counts);
+		*counts = NULL;
+
+		return false;
+	}
+
+	return true;
+}
+
+/**
+@fn readArchiveTile
+@brief Reads one tile of a tile archive. The archive is mapped into memory
+where the system allows it, so only the header, the index entry and the tile
+itself are read from disk.
+@param fileName The name of the archive.
+@param column The column of the tile.
+@param row The row of the tile.
+@param params Pointer to where the description of the whole image will be
+stored.
+@param counts Pointer to where the dynamically allocated stages of the tile
+will be stored, in row-major order.
+@param width Pointer to where the width of the tile will be stored.
+@param height Pointer to where the height of the tile will be stored.
+@return true if the tile was read, false otherwise.
+*/
+bool readArchiveTile (const char *fileName, long column, long row,
+					  JuliaParams *params, Sint32 **counts, long *width,
+					  long *height)
+{
+#ifdef ARCHIVE_MMAP
+	int fd = open(fileName, O_RDONLY);
+	struct stat status;
+
+	if (fd < 0)
+	{
+		return false;
+	}
+	if (fstat(fd, &status) != 0 || status.st_size <= 0)
+	{
+		close(fd);
+
+		return false;
+	}
+
+	void *bytes = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE,
+					   fd, 0);
+
+	close(fd);
+
+	if (bytes == MAP_FAILED)
+	{
+		return false;
+	}
+
+	bool read = decodeArchiveTile((const Uint8*)bytes,
+								  (Uint64)status.st_size, column, row,
+								  params, counts, width, height);
+
+	munmap(bytes, (size_t)status.st_size);
+
+	return read;
+#else
+	/* Without mmap(), read the whole archive. */
+	FILE *file = fopen(fileName, "rb");
+
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+
+	long fileSize = ftell(file);
+	Uint8 *bytes = (fileSize > 0) ? (Uint8*)malloc(fileSize) : NULL;
+
+	rewind(file);
+
+	bool read = bytes != NULL &&
+				fread(bytes, 1, fileSize, file) == (size_t)fileSize &&
+				decodeArchiveTile(bytes, (Uint64)fileSize, column, row,
+								  params, counts, width, height);
+
+	free(bytes);
+	fclose(file);
+
+	return read;
+#endif
+}
+
+/**
+@fn runReadTile
+@brief Reads one tile of a tile archive and writes it to disk as a BMP image.
+@details runReadTile() is called as
+	Project04_01 --read-tile archiveFile column row outputFile
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@return An error code. 0 if the tile was written.
+*/
+int runReadTile (int argc, char *argv[])
+{
+	if (argc < READ_TILE_ARGS)
+	{
+		fprintf(stderr, "Usage: %s --read-tile archiveFile column row "
+				"outputFile\n", argv[0]);
+
+		return INSUFFICIENT_ARGS_FAIL;
+	}
+
+	char *columnEnd = NULL;
+	char *rowEnd = NULL;
+	long column = strtol(argv[3], &columnEnd, 10);
+	long row = strtol(argv[4], &rowEnd, 10);
+
+	if (columnEnd == argv[3] || *columnEnd != '\0' || rowEnd == argv[4] ||
+		*rowEnd != '\0')
+	{
+		fprintf(stderr, "Non-number arg given. Column and row must be "
+				"numbers.\n");
+
+		return ARG_NOT_A_NUMBER_FAIL;
+	}
+
+	/*** Read the tile. ***/
+	JuliaParams params;
+	Sint32 *counts = NULL;
+	long width, height;
+	Uint64 startTime = SDL_GetPerformanceCounter();
+
+	if (!readArchiveTile(argv[2], column, row, &params, &counts, &width,
+						 &height))
+	{
+		fprintf(stderr, "Could not read tile (%ld, %ld) of '%s'.\n", column,
+				row, argv[2]);
+
+		return ARCHIVE_READ_FAIL;
+	}
+
+	double readTime = (double)(SDL_GetPerformanceCounter() - startTime) *
+					  1000.0 / SDL_GetPerformanceFrequency();
+
+	printf("Read tile (%ld, %ld) in %.3fms\n", column, row, readTime);
+
+	/*** Color the tile and write it. ***/
+	SDL_Color **colorMap = newColorMap(width, height);
+
+	for (long x = 0; x < width; x++)
+	{
+		for (long y = 0; y < height; y++)
+		{
+			Sint32 stage = counts[y * width + x];
+
+			colorMap[x][y] = (stage == JULIA_IN_SET) ? colorInSet() :
+							 colorOutOfSet(stage);
+		}
+	}
+
+	bool written = writeColorMap(argv[5], colorMap, width, height);
+
+	freeColorMap(colorMap, width, height);
+	free(counts);
+
+	if (!written)
+	{
+		fprintf(stderr, "Could not write '%s'.\n", argv[5]);
+
+		return ARCHIVE_READ_FAIL;
+	}
+
+	return GET_ARGS_SUCCEED;
+}
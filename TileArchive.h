@@ -0,0 +1,173 @@
+/**
+@file TileArchive.h
+@author Rob Thomas
+@brief Contains functions for storing the iteration counts of a Julia set image
+as a compressed tile archive, and for reading single tiles back out of it.
+@details A tile archive starts with a header of ARCHIVE_HEADER_SIZE bytes that
+describes the image, followed by an index of ARCHIVE_INDEX_ENTRY_SIZE bytes per
+tile and then the compressed tiles in the order they were finished. Tile
+(column, row) is entry row * tilesAcross + column of the index, which gives the
+offset and size of its data. All numbers are little-endian.
+
+Each tile holds the stage (see JuliaSet.h) of its pixels in row-major order.
+Every stage is replaced by its difference from the stage before it, and each
+run of equal differences is stored as two varints: the zigzag-encoded
+difference and the length of the run minus one. Interiors and smooth bands
+therefore shrink to a few bytes per row.
+*/
+
+#ifndef TILEARCHIVE_H
+#define TILEARCHIVE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+#include "HelperFunctions.h"
+
+
+/**
+@def ARCHIVE_WRITE_FAIL
+@brief Error code indicating that a tile archive could not be written.
+*/
+#define ARCHIVE_WRITE_FAIL 9
+
+/**
+@def ARCHIVE_READ_FAIL
+@brief Error code indicating that a tile could not be read from an archive.
+*/
+#define ARCHIVE_READ_FAIL 10
+
+/**
+@def ARCHIVE_MAGIC
+@brief The four bytes every tile archive starts with.
+*/
+#define ARCHIVE_MAGIC "JTA1"
+
+/**
+@def ARCHIVE_HEADER_SIZE
+@brief The size (in bytes) of the header of a tile archive.
+*/
+#define ARCHIVE_HEADER_SIZE 88
+
+/**
+@def ARCHIVE_INDEX_ENTRY_SIZE
+@brief The size (in bytes) of the index entry of one tile: its offset (8
+bytes), its size (4 bytes) and 4 unused bytes.
+*/
+#define ARCHIVE_INDEX_ENTRY_SIZE 16
+
+/**
+@def MAX_VARINT_BYTES
+@brief The most bytes a 32-bit varint takes.
+*/
+#define MAX_VARINT_BYTES 5
+
+
+/**
+@typedef TileIndexEntry
+@brief The TileIndexEntry struct tells where the data of one tile is stored.
+*/
+typedef struct TileIndexEntry
+{
+	Uint64 offset;
+	Uint32 size;
+} TileIndexEntry;
+
+/**
+@typedef TileArchive
+@brief The TileArchive struct describes a tile archive that is being written.
+Threads compress their tiles independently and only take the lock to append the
+data to file and record it in the index.
+*/
+typedef struct TileArchive
+{
+	JuliaParams params;
+	long tileSize, tilesAcross, tilesDown;
+	FILE *file;
+	SDL_mutex *lock;
+	Uint64 nextOffset;
+	TileIndexEntry *index;
+	SDL_atomic_t nextTile;
+	bool failed;
+} TileArchive;
+
+
+/**
+@fn compressTile
+@brief Compresses the stages of one tile.
+@param counts The stages of the tile in row-major order.
+@param numCounts The number of stages.
+@param data Where the compressed tile is stored. It must have room for 
+2 * MAX_VARINT_BYTES * numCounts bytes.
+@return The size (in bytes) of the compressed tile.
+*/
+size_t compressTile (const Sint32 *counts, long numCounts, Uint8 *data);
+
+/**
+@fn decompressTile
+@brief Restores the stages of one tile from its compressed data.
+@param data The compressed tile.
+@param size The size (in bytes) of the compressed tile.
+@param counts Where the stages are stored.
+@param numCounts The number of stages in the tile.
+@return true if the data held exactly numCounts stages, false otherwise.
+*/
+bool decompressTile (const Uint8 *data, size_t size, Sint32 *counts, 
+					 long numCounts);
+
+/**
+@fn archiveWorker
+@brief Computes, compresses and stores tiles of an archive until none are
+left.
+@param data A void pointer to be cast into a TileArchive struct.
+*/
+int archiveWorker (void *data);
+
+/**
+@fn readArchiveTile
+@brief Reads one tile of a tile archive. The archive is mapped into memory
+where the system allows it, so only the header, the index entry and the tile
+itself are read from disk.
+@param fileName The name of the archive.
+@param column The column of the tile.
+@param row The row of the tile.
+@param params Pointer to where the description of the whole image will be
+stored.
+@param counts Pointer to where the dynamically allocated stages of the tile
+will be stored, in row-major order.
+@param width Pointer to where the width of the tile will be stored.
+@param height Pointer to where the height of the tile will be stored.
+@return true if the tile was read, false otherwise.
+*/
+bool readArchiveTile (const char *fileName, long column, long row, 
+					  JuliaParams *params, Sint32 **counts, long *width,
+					  long *height);
+
+/**
+@fn runArchive
+@brief Renders a Julia set into a tile archive.
+@details runArchive() is called as
+	Project04_01 --archive windowWidth windowHeight planeWidth planeHeight
+						   centerX centerY a b tileSize numberOfThreads 
+						   outputFile [--map=NAME]
+with the same meaning as the arguments of main().
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if the archive was written.
+*/
+int runArchive (int argc, char *argv[], int numIterations);
+
+/**
+@fn runReadTile
+@brief Reads one tile of a tile archive and writes it to disk as a BMP image.
+@details runReadTile() is called as
+	Project04_01 --read-tile archiveFile column row outputFile
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@return An error code. 0 if the tile was written.
+*/
+int runReadTile (int argc, char *argv[]);
+
+#endif /* TILEARCHIVE_H */
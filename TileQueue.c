@@ -0,0 +1,120 @@
+/**
+@file TileQueue.c
+@author Rob Thomas
+@brief Contains a lock-free queue through which worker threads report the
+tiles of an image they have finished.
+*/
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "TileQueue.h"
+
+
+/**
+@fn newTileQueue
+@brief Dynamically allocates an empty tile queue.
+@param capacity The number of tiles the queue can hold.
+@return The new queue, or NULL if it could not be allocated.
+*/
+TileQueue * newTileQueue (long capacity)
+{
+	TileQueue *queue = (TileQueue*)malloc(sizeof(TileQueue));
+
+	if (queue == NULL)
+	{
+		return NULL;
+	}
+
+	queue->slots = (TileSlot*)malloc(sizeof(TileSlot) * capacity);
+
+	if (queue->slots == NULL)
+	{
+		free(queue);
+
+		return NULL;
+	}
+
+	queue->capacity = capacity;
+	resetTileQueue(queue);
+
+	return queue;
+}
+
+/**
+@fn resetTileQueue
+@brief Empties a tile queue so that it can take capacity more tiles. No thread
+may push to the queue while it is reset.
+@param queue The queue to reset.
+*/
+void resetTileQueue (TileQueue *queue)
+{
+	for (long i = 0; i < queue->capacity; i++)
+	{
+		SDL_AtomicSet(&queue->slots[i].ready, 0);
+	}
+
+	SDL_AtomicSet(&queue->tail, 0);
+	queue->head = 0;
+}
+
+/**
+@fn pushTile
+@brief Adds a finished tile to the queue. Safe to call from any thread.
+@param queue The queue to add to.
+@param tile The finished tile.
+@return true if the tile was added, false if the queue was full.
+*/
+bool pushTile (TileQueue *queue, Tile tile)
+{
+	long slot = SDL_AtomicAdd(&queue->tail, 1);
+
+	if (slot >= queue->capacity)
+	{
+		return false;
+	}
+
+	queue->slots[slot].tile = tile;
+
+	/* Publish the tile only after it has been written, and after the pixels
+	   of the tile that were written before the push. */
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&queue->slots[slot].ready, 1);
+
+	return true;
+}
+
+/**
+@fn popTile
+@brief Takes the oldest tile out of the queue. Only one thread may pop tiles.
+@param queue The queue to take from.
+@param tile Pointer to where the tile will be stored.
+@return true if a tile was taken, false if no finished tile is waiting.
+*/
+bool popTile (TileQueue *queue, Tile *tile)
+{
+	if (queue->head >= queue->capacity || 
+		!SDL_AtomicGet(&queue->slots[queue->head].ready))
+	{
+		return false;
+	}
+
+	SDL_MemoryBarrierAcquire();
+	*tile = queue->slots[queue->head].tile;
+	queue->head++;
+
+	return true;
+}
+
+/**
+@fn freeTileQueue
+@brief Frees a dynamically allocated tile queue.
+@param queue The queue to be freed.
+*/
+void freeTileQueue (TileQueue *queue)
+{
+	free(queue->slots);
+	free(queue);
+}
@@ -0,0 +1,94 @@
+/**
+@file TileQueue.h
+@author Rob Thomas
+@brief Contains a lock-free queue through which worker threads report the
+tiles of an image they have finished.
+*/
+
+#ifndef TILEQUEUE_H
+#define TILEQUEUE_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+
+/**
+@typedef Tile
+@brief The Tile struct describes a finished rectangle of the window: the
+columns x0 to x1 - 1 and the rows y0 to y1 - 1.
+*/
+typedef struct Tile
+{
+	long x0, y0, x1, y1;
+} Tile;
+
+/**
+@typedef TileSlot
+@brief The TileSlot struct holds one entry of a TileQueue. ready is set once
+the tile has been written to the slot.
+*/
+typedef struct TileSlot
+{
+	Tile tile;
+	SDL_atomic_t ready;
+} TileSlot;
+
+/**
+@typedef TileQueue
+@brief The TileQueue struct is a queue that any number of threads push tiles
+to and a single thread pops them from, without locks. Each push claims the
+next slot by incrementing tail and then marks the slot ready, and the popping
+thread takes slots in order from head while they are ready. The queue holds up
+to capacity tiles between two calls to resetTileQueue().
+*/
+typedef struct TileQueue
+{
+	TileSlot *slots;
+	long capacity;
+	SDL_atomic_t tail;
+	long head;
+} TileQueue;
+
+
+/**
+@fn newTileQueue
+@brief Dynamically allocates an empty tile queue.
+@param capacity The number of tiles the queue can hold.
+@return The new queue, or NULL if it could not be allocated.
+*/
+TileQueue * newTileQueue (long capacity);
+
+/**
+@fn resetTileQueue
+@brief Empties a tile queue so that it can take capacity more tiles. No thread
+may push to the queue while it is reset.
+@param queue The queue to reset.
+*/
+void resetTileQueue (TileQueue *queue);
+
+/**
+@fn pushTile
+@brief Adds a finished tile to the queue. Safe to call from any thread.
+@param queue The queue to add to.
+@param tile The finished tile.
+@return true if the tile was added, false if the queue was full.
+*/
+bool pushTile (TileQueue *queue, Tile tile);
+
+/**
+@fn popTile
+@brief Takes the oldest tile out of the queue. Only one thread may pop tiles.
+@param queue The queue to take from.
+@param tile Pointer to where the tile will be stored.
+@return true if a tile was taken, false if no finished tile is waiting.
+*/
+bool popTile (TileQueue *queue, Tile *tile);
+
+/**
+@fn freeTileQueue
+@brief Frees a dynamically allocated tile queue.
+@param queue The queue to be freed.
+*/
+void freeTileQueue (TileQueue *queue);
+
+#endif /* TILEQUEUE_H */
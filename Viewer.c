@@ -0,0 +1,413 @@
+/**
+@file Viewer.c
+@author Rob Thomas
+@brief Contains the interactive window in which a Julia set is shown, explored
+and deepened.
+*/
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "Drawing.h"
+#include "HelperFunctions.h"
+#include "JuliaSet.h"
+#include "TileQueue.h"
+#include "Deadline.h"
+
+#include "Viewer.h"
+
+
+/**
+@fn renderInWindow
+@brief Runs partialFill() in one new thread per data packet and shows each
+tile in the window as soon as a thread reports it finished. Finished tiles are
+collected and presented once per frame until every tile has been shown, or
+until the user gives a command, which cancels the render.
+@param dataList The data packet of each thread.
+@param numberOfThreads The number of threads to run.
+@param renderer The renderer of the window.
+@param texture The texture that shows the color map.
+@param generation The counter that is advanced to cancel the render.
+@param point Pointer to where the pixel that was clicked will be stored.
+@return The command that cancelled the render, or COMMAND_NONE if it was
+finished.
+*/
+static int renderInWindow (ThreadData dataList[], long numberOfThreads,
+						   SDL_Renderer *renderer, SDL_Texture *texture,
+						   SDL_atomic_t *generation, SDL_Point *point)
+{
+	SDL_Thread *threadList[numberOfThreads];
+	TileQueue *tiles = dataList[0].tiles;
+	SDL_Color **colorMap = *(dataList[0].colorMapPtr);
+	int command = COMMAND_NONE;
+
+	resetTileQueue(tiles);
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		dataList[threadID].generation = generation;
+		dataList[threadID].renderGeneration = SDL_AtomicGet(generation);
+	}
+
+	Uint32 startTime = SDL_GetTicks();
+	Uint32 firstTileTime = 0;
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		threadList[threadID] = SDL_CreateThread( partialFill, "Current Thread",
+												(void*)&(dataList[threadID]) );
+	}
+
+	/* Each frame, upload every tile that was finished since the last frame
+	   and present the result. */
+	long tilesShown = 0;
+
+	while (tilesShown < tiles->capacity)
+	{
+		command = pollCommand(point);
+
+		if (command != COMMAND_NONE)
+		{
+			/* The render is stale: tell the threads to stop. */
+			SDL_AtomicAdd(generation, 1);
+
+			break;
+		}
+
+		Tile tile;
+		long newTiles = 0;
+
+		while (popTile(tiles, &tile))
+		{
+			drawTile(texture, colorMap, tile);
+			newTiles++;
+		}
+
+		if (newTiles == 0)
+		{
+			SDL_Delay(FRAME_DELAY);
+
+			continue;
+		}
+
+		if (tilesShown == 0)
+		{
+			firstTileTime = SDL_GetTicks() - startTime;
+		}
+
+		tilesShown += newTiles;
+
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+		SDL_RenderPresent(renderer);
+	}
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		SDL_WaitThread(threadList[threadID], NULL);
+	}
+
+	if (command == COMMAND_NONE)
+	{
+		printf("First tile: %dms. Processing time: %dms\n", firstTileTime,
+			   SDL_GetTicks() - startTime);
+	}
+	else
+	{
+		printf("Cancelled after %dms.\n", SDL_GetTicks() - startTime);
+	}
+
+	return command;
+}
+
+/**
+@fn changeView
+@brief Works out the view that a zoom or pan command leads to.
+@param params The current view.
+@param command The command (COMMAND_ZOOM_IN, COMMAND_ZOOM_OUT or one of the
+COMMAND_PAN_ commands).
+@param point The pixel that was clicked, for zoom commands.
+@return The new view.
+*/
+static JuliaParams changeView (JuliaParams params, int command, 
+							   SDL_Point point)
+{
+	switch (command)
+	{
+		case COMMAND_ZOOM_IN:
+		case COMMAND_ZOOM_OUT:
+			params.centerX = XTransform(point.x, params.centerX, 
+										params.planeWidth, params.windowWidth);
+			params.centerY = YTransform(point.y, params.centerY,
+										params.planeHeight, 
+										params.windowHeight);
+
+			if (command == COMMAND_ZOOM_IN)
+			{
+				params.planeWidth /= ZOOM_FACTOR;
+				params.planeHeight /= ZOOM_FACTOR;
+			}
+			else
+			{
+				params.planeWidth *= ZOOM_FACTOR;
+				params.planeHeight *= ZOOM_FACTOR;
+			}
+			break;
+		case COMMAND_PAN_LEFT:
+			params.centerX -= params.planeWidth * PAN_FRACTION;
+			break;
+		case COMMAND_PAN_RIGHT:
+			params.centerX += params.planeWidth * PAN_FRACTION;
+			break;
+		case COMMAND_PAN_UP:
+			params.centerY += params.planeHeight * PAN_FRACTION;
+			break;
+		case COMMAND_PAN_DOWN:
+			params.centerY -= params.planeHeight * PAN_FRACTION;
+			break;
+	}
+
+	return params;
+}
+
+/**
+@fn swapWithCache
+@brief Swaps the current view with the view in the cache. The cache buffers
+are allocated the first time they are needed.
+@param dataList The data packet of each thread.
+@param numberOfThreads The number of threads.
+@param cache The cache of the previous view.
+*/
+static void swapWithCache (ThreadData dataList[], long numberOfThreads,
+						   ViewCache *cache)
+{
+	SDL_Color ***colorMapPtr = dataList[0].colorMapPtr;
+	OrbitState ***orbitMapPtr = dataList[0].orbitMapPtr;
+	long windowWidth = dataList[0].params.windowWidth;
+	long windowHeight = dataList[0].params.windowHeight;
+
+	if (cache->colorMap == NULL)
+	{
+		cache->colorMap = newColorMap(windowWidth, windowHeight);
+
+		if (*orbitMapPtr != NULL)
+		{
+			cache->orbitMap = newOrbitMap(windowWidth, windowHeight);
+		}
+	}
+
+	SDL_Color **colorMap = *colorMapPtr;
+	OrbitState **orbitMap = *orbitMapPtr;
+	JuliaParams params = dataList[0].params;
+
+	*colorMapPtr = cache->colorMap;
+	*orbitMapPtr = cache->orbitMap;
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		dataList[threadID].params = cache->params;
+	}
+
+	cache->colorMap = colorMap;
+	cache->orbitMap = orbitMap;
+	cache->params = params;
+}
+
+/**
+@fn sameView
+@brief Checks whether two views show the same part of the complex plane.
+@param a The first view.
+@param b The second view.
+@return true if the views are the same, false otherwise.
+*/
+static bool sameView (const JuliaParams *a, const JuliaParams *b)
+{
+	return (a->centerX == b->centerX && a->centerY == b->centerY &&
+			a->planeWidth == b->planeWidth && a->planeHeight == b->planeHeight);
+}
+
+/**
+@fn runViewer
+@brief Shows the Julia set described by the data packets in the window and
+lets the user explore it until they close the window. Each render is shown
+tile by tile as the threads finish it. Any command given during a render
+cancels it, so that the threads start on the new view right away. Clicking
+with the left or right mouse button zooms in or out around the click, the
+arrow keys move the view, D doubles the number of iterations and backspace
+goes back to the previous view. With a frame budget, each view is instead
+shown frame by frame at whatever quality fits in the budget and refined while
+the user does nothing (see renderDeadline()).
+@param dataList The data packet of each thread. They share the color map and
+orbit map (which may be NULL) that the viewer draws.
+@param numberOfThreads The number of threads to run.
+@param renderer The renderer of the window.
+@param frameBudget The time (in milliseconds) each frame may take, or 0 to
+show each render tile by tile as the threads finish it.
+@return COMMAND_QUIT when the user closed the window, or COMMAND_ERROR if the
+viewer failed.
+*/
+int runViewer (ThreadData dataList[], long numberOfThreads, 
+			   SDL_Renderer *renderer, int frameBudget)
+{
+	long windowWidth = dataList[0].params.windowWidth;
+	long windowHeight = dataList[0].params.windowHeight;
+	long chunkColumns = dataList[0].chunkColumns;
+
+	SDL_Texture *texture = newColorTexture(renderer, windowWidth, windowHeight);
+	TileQueue *tiles = newTileQueue((windowWidth + chunkColumns - 1) / 
+									chunkColumns);
+	DeadlineRender *deadline = NULL;
+
+	if (frameBudget > 0)
+	{
+		deadline = newDeadlineRender(windowWidth, windowHeight);
+	}
+
+	if (texture == NULL || tiles == NULL ||
+		(frameBudget > 0 && deadline == NULL))
+	{
+		fprintf(stderr, "Could not set up drawing to the window.\n");
+
+		if (texture != NULL)
+		{
+			SDL_DestroyTexture(texture);
+		}
+		if (tiles != NULL)
+		{
+			freeTileQueue(tiles);
+		}
+		if (deadline != NULL)
+		{
+			freeDeadlineRender(deadline);
+		}
+
+		return COMMAND_ERROR;
+	}
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		dataList[threadID].tiles = tiles;
+	}
+
+	SDL_atomic_t generation;
+	ViewCache cache;
+	SDL_Point point = {0, 0};
+
+	SDL_AtomicSet(&generation, 0);
+	cache.colorMap = NULL;
+	cache.orbitMap = NULL;
+	cache.valid = false;
+
+	/*** Render the current view unless it is finished, then carry out the
+		 command that cancelled it or that the user gives next. ***/
+	int command;
+	bool finished = false;
+
+	while (true)
+	{
+		command = COMMAND_NONE;
+
+		if (!finished && deadline != NULL)
+		{
+			command = renderDeadline(deadline, &dataList[0].params,
+									 *(dataList[0].colorMapPtr),
+									 numberOfThreads, frameBudget, renderer,
+									 texture, &point);
+			finished = (command == COMMAND_NONE);
+		}
+		else if (!finished)
+		{
+			command = renderInWindow(dataList, numberOfThreads, renderer, 
+									 texture, &generation, &point);
+			finished = (command == COMMAND_NONE);
+		}
+
+		if (command == COMMAND_NONE)
+		{
+			command = waitForCommand(&point);
+		}
+
+		if (command == COMMAND_QUIT || command == COMMAND_ERROR)
+		{
+			break;
+		}
+
+		if (command == COMMAND_DEEPEN)
+		{
+			for (int threadID = 0; threadID < numberOfThreads; threadID++)
+			{
+				dataList[threadID].params.numIterations *= 2;
+			}
+
+			printf("Deepening to %d iterations.\n", 
+				   dataList[0].params.numIterations);
+
+			finished = false;
+		}
+		else if (command == COMMAND_BACK && cache.valid)
+		{
+			/* Show what is known of the previous view right away; the next
+			   render only continues the orbits that are not finished. */
+			swapWithCache(dataList, numberOfThreads, &cache);
+
+			Tile whole = {0, 0, windowWidth, windowHeight};
+
+			drawTile(texture, *(dataList[0].colorMapPtr), whole);
+
+			finished = false;
+		}
+		else if (command >= COMMAND_ZOOM_IN && command <= COMMAND_PAN_DOWN)
+		{
+			JuliaParams view = changeView(dataList[0].params, command, point);
+
+			swapWithCache(dataList, numberOfThreads, &cache);
+
+			/* Unless the new view is the cached one, start it over. */
+			if (cache.valid && sameView(&dataList[0].params, &view))
+			{
+				Tile whole = {0, 0, windowWidth, windowHeight};
+
+				drawTile(texture, *(dataList[0].colorMapPtr), whole);
+			}
+			else
+			{
+				for (int threadID = 0; threadID < numberOfThreads; threadID++)
+				{
+					dataList[threadID].params = view;
+				}
+
+				if (*(dataList[0].orbitMapPtr) != NULL)
+				{
+					clearOrbitMap(*(dataList[0].orbitMapPtr), windowWidth,
+								  windowHeight);
+				}
+			}
+
+			cache.valid = true;
+			finished = false;
+		}
+	}
+
+	/*** Clean up the viewer. The current color map and orbit map belong to
+		 the caller. ***/
+	if (cache.colorMap != NULL)
+	{
+		freeColorMap(cache.colorMap, windowWidth, windowHeight);
+	}
+	if (cache.orbitMap != NULL)
+	{
+		freeOrbitMap(cache.orbitMap, windowWidth, windowHeight);
+	}
+
+	if (deadline != NULL)
+	{
+		freeDeadlineRender(deadline);
+	}
+
+	SDL_DestroyTexture(texture);
+	freeTileQueue(tiles);
+
+	return command;
+}
@@ -0,0 +1,76 @@
+/**
+@file Viewer.h
+@author Rob Thomas
+@brief Contains the interactive window in which a Julia set is shown, explored
+and deepened.
+*/
+
+#ifndef VIEWER_H
+#define VIEWER_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "HelperFunctions.h"
+
+
+/**
+@def FRAME_DELAY
+@brief How long (in milliseconds) to wait before looking for finished tiles
+again when none were ready.
+*/
+#define FRAME_DELAY 16
+
+/**
+@def PAN_FRACTION
+@brief The fraction of the view that the arrow keys move it by.
+*/
+#define PAN_FRACTION 0.25
+
+/**
+@def ZOOM_FACTOR
+@brief How much a click zooms in or out.
+*/
+#define ZOOM_FACTOR 2.0
+
+
+/**
+@typedef ViewCache
+@brief The ViewCache struct keeps the image of the previous view, together
+with its orbits. A render that was cancelled by a view change leaves its
+finished tiles in the cache, so going back to that view only computes the
+rest of it.
+*/
+typedef struct ViewCache
+{
+	JuliaParams params;
+	SDL_Color **colorMap;
+	OrbitState **orbitMap;
+	bool valid;
+} ViewCache;
+
+
+/**
+@fn runViewer
+@brief Shows the Julia set described by the data packets in the window and
+lets the user explore it until they close the window. Each render is shown
+tile by tile as the threads finish it. Any command given during a render
+cancels it, so that the threads start on the new view right away. Clicking
+with the left or right mouse button zooms in or out around the click, the
+arrow keys move the view, D doubles the number of iterations and backspace
+goes back to the previous view. With a frame budget, each view is instead
+shown frame by frame at whatever quality fits in the budget and refined while
+the user does nothing (see renderDeadline()).
+@param dataList The data packet of each thread. They share the color map and
+orbit map (which may be NULL) that the viewer draws.
+@param numberOfThreads The number of threads to run.
+@param renderer The renderer of the window.
+@param frameBudget The time (in milliseconds) each frame may take, or 0 to
+show each render tile by tile as the threads finish it.
+@return COMMAND_QUIT when the user closed the window, or COMMAND_ERROR if the
+viewer failed.
+*/
+int runViewer (ThreadData dataList[], long numberOfThreads, 
+			   SDL_Renderer *renderer, int frameBudget);
+
+#endif /* VIEWER_H */
@@ -0,0 +1,460 @@
+/**
+@file Zoom.c
+@author Rob Thomas
+@brief Contains functions for rendering a zoom video: a sequence of frames
+that zoom in on (or out of) a point of a Julia set.
+*/
+
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+
+#include "Drawing.h"
+#include "HelperFunctions.h"
+#include "InverseIteration.h"
+#include "JuliaSet.h"
+
+#include "Zoom.h"
+
+
+/**
+@def ZOOM_ARGS
+@brief The number of command line arguments (including the program name and
+--zoom) that runZoom() requires.
+*/
+#define ZOOM_ARGS 13
+
+/**
+@def ZOOM_FILE_NAME_SIZE
+@brief The size of the buffer that holds the file name of a frame.
+*/
+#define ZOOM_FILE_NAME_SIZE 1024
+
+
+/**
+@fn partialZoomStrip
+@brief Computes the rows of the strip that belong to one thread.
+@param data A void pointer to be cast into a ZoomData struct.
+*/
+int partialZoomStrip (void *data)
+{
+	ZoomData *d = (ZoomData*)data;
+	ZoomStrip *strip = d->strip;
+	double *re = (double*)malloc(sizeof(double) * strip->radii);
+	double *im = (double*)malloc(sizeof(double) * strip->radii);
+
+	if (re == NULL || im == NULL)
+	{
+		free(re);
+		free(im);
+
+		return 1;
+	}
+
+	for (long v = d->threadID; v < strip->angles; v += d->numberOfThreads)
+	{
+		double cosAngle = cos(v * strip->angleStep);
+		double sinAngle = sin(v * strip->angleStep);
+
+		for (long u = 0; u < strip->radii; u++)
+		{
+			double radius = exp(strip->logMinRadius + u * strip->logStep);
+
+			re[u] = strip->params.centerX + radius * cosAngle;
+			im[u] = strip->params.centerY + radius * sinAngle;
+		}
+
+		fillJuliaPoints(&strip->params, re, im, strip->radii,
+						strip->counts + v * strip->radii);
+	}
+
+	free(re);
+	free(im);
+
+	return 0;
+}
+
+/**
+@fn partialZoomFrame
+@brief Fills the columns of a frame that belong to one thread, taking each
+pixel from the strip or computing it directly if it is too close to the
+center.
+@param data A void pointer to be cast into a ZoomData struct.
+*/
+int partialZoomFrame (void *data)
+{
+	ZoomData *d = (ZoomData*)data;
+	ZoomStrip *strip = d->strip;
+	const JuliaParams *p = &d->frame;
+
+	/* How far along the strip this frame's pixel size moves every pixel. */
+	double shift = (log(p->planeWidth / p->windowWidth) -
+					strip->logMinRadius) / strip->logStep;
+
+	/* The pixels of a column that are computed directly. */
+	double *re = (double*)malloc(sizeof(double) * p->windowHeight);
+	double *im = (double*)malloc(sizeof(double) * p->windowHeight);
+	Sint32 *stages = (Sint32*)malloc(sizeof(Sint32) * p->windowHeight);
+	long *rows = (long*)malloc(sizeof(long) * p->windowHeight);
+
+	if (re == NULL || im == NULL || stages == NULL || rows == NULL)
+	{
+		free(re);
+		free(im);
+		free(stages);
+		free(rows);
+
+		return 1;
+	}
+
+	for (long x = d->threadID; x < p->windowWidth; x += d->numberOfThreads)
+	{
+		const double *pixelRadius = strip->pixelRadius + x * p->windowHeight;
+		const Sint32 *pixelAngle = strip->pixelAngle + x * p->windowHeight;
+		long numDirect = 0;
+
+		for (long y = 0; y < p->windowHeight; y++)
+		{
+			double u = pixelRadius[y] + shift;
+
+			/* Pixels closer to the center than the strip reaches. */
+			if (u < 0.0)
+			{
+				re[numDirect] = XTransform(x, p->centerX, p->planeWidth,
+										   p->windowWidth);
+				im[numDirect] = YTransform(y, p->centerY, p->planeHeight,
+										   p->windowHeight);
+				rows[numDirect] = y;
+				numDirect++;
+				continue;
+			}
+
+			/* Take the nearest sample of the strip. */
+			long column = (long)(u + 0.5);
+
+			if (column >= strip->radii)
+			{
+				column = strip->radii - 1;
+			}
+
+			Sint32 stage = strip->counts[pixelAngle[y] * strip->radii +
+										 column];
+
+			d->colorMap[x][y] = (stage == JULIA_IN_SET) ? colorInSet() :
+								colorOutOfSet(stage);
+		}
+
+		fillJuliaPoints(p, re, im, numDirect, stages);
+
+		for (long i = 0; i < numDirect; i++)
+		{
+			d->colorMap[x][rows[i]] = (stages[i] == JULIA_IN_SET) ?
+									  colorInSet() : colorOutOfSet(stages[i]);
+		}
+
+		d->directPoints += numDirect;
+	}
+
+	free(re);
+	free(im);
+	free(stages);
+	free(rows);
+
+	return 0;
+}
+
+/**
+@fn projectPixels
+@brief Works out where on the strip each pixel of a frame falls, in the units
+described by ZoomStrip.
+@param strip The strip, whose pixelRadius and pixelAngle are filled in.
+@param windowWidth The width (in pixels) of a frame.
+@param windowHeight The height (in pixels) of a frame.
+*/
+static void projectPixels (ZoomStrip *strip, long windowWidth,
+						   long windowHeight)
+{
+	for (long x = 0; x < windowWidth; x++)
+	{
+		double dx = XTransform(x, 0.0, windowWidth, windowWidth);
+
+		for (long y = 0; y < windowHeight; y++)
+		{
+			double dy = YTransform(y, 0.0, windowHeight, windowHeight);
+			long v = lround(atan2(dy, dx) / strip->angleStep);
+
+			if (v < 0)
+			{
+				v += strip->angles;
+			}
+			if (v >= strip->angles)
+			{
+				v -= strip->angles;
+			}
+
+			/* The center itself is at -infinity, so it is always computed
+			   directly. */
+			strip->pixelRadius[x * windowHeight + y] =
+				log(sqrt(dx * dx + dy * dy)) / strip->logStep;
+			strip->pixelAngle[x * windowHeight + y] = (Sint32)v;
+		}
+	}
+}
+
+/**
+@fn runZoomThreads
+@brief Runs one function in one new thread per data packet and waits for all
+of them to finish.
+@param fn The function to run.
+@param dataList The data packet of each thread.
+@param numberOfThreads The number of threads to run.
+@return true if every thread succeeded, false otherwise.
+*/
+static bool runZoomThreads (SDL_ThreadFunction fn, ZoomData dataList[],
+							long numberOfThreads)
+{
+	SDL_Thread *threadList[numberOfThreads];
+	bool succeeded = true;
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		threadList[threadID] = SDL_CreateThread(fn, "Zoom Thread",
+												(void*)&(dataList[threadID]));
+	}
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		int status = 1;
+
+		SDL_WaitThread(threadList[threadID], &status);
+		succeeded = succeeded && (status == 0);
+	}
+
+	return succeeded;
+}
+
+/**
+@fn runZoom
+@brief Renders a zoom video and writes its frames to disk.
+@details runZoom() is called as
+	Project04_01 --zoom windowWidth windowHeight startWidth endWidth centerX
+						centerY a b numFrames numberOfThreads outputPrefix
+						[--map=NAME]
+where the width of the plane shown goes from startWidth in the first frame to
+endWidth in the last one, shrinking by the same factor every frame. Frame i
+is written to outputPrefix followed by i in four digits and ".bmp".
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if every frame was written.
+*/
+int runZoom (int argc, char *argv[], int numIterations)
+{
+	/*** Read in command line arguments. ***/
+	if (argc < ZOOM_ARGS)
+	{
+		fprintf(stderr, "Usage: %s --zoom windowWidth windowHeight startWidth "
+				"endWidth centerX centerY a b numFrames numberOfThreads "
+				"outputPrefix [--map=NAME]\n", argv[0]);
+
+		return INSUFFICIENT_ARGS_FAIL;
+	}
+
+	double values[10];
+
+	for (int i = 0; i < 10; i++)
+	{
+		char *endptr = NULL;
+
+		values[i] = strtod(argv[i + 2], &endptr);
+
+		if (endptr == argv[i + 2] || *endptr != '\0')
+		{
+			fprintf(stderr, "Non-number arg given. All args must be numbers.\n");
+
+			return ARG_NOT_A_NUMBER_FAIL;
+		}
+	}
+
+	long windowWidth = (long)values[0];
+	long windowHeight = (long)values[1];
+	long numFrames = (long)values[8];
+	long numberOfThreads = (long)values[9];
+
+	if (windowWidth <= 0 || windowHeight <= 0 || values[2] <= 0 ||
+		values[3] <= 0 || numFrames <= 0 || numberOfThreads <= 0)
+	{
+		fprintf(stderr, "Window size, plane widths, number of frames and "
+				"number of threads must be greater than 0.\n");
+
+		return ARG_BELOW_ONE_FAIL;
+	}
+
+	RenderOptions options;
+	int result = getOptions(argc, argv, ZOOM_ARGS, &options);
+
+	if (result)
+	{
+		return result;
+	}
+	if (options.coloring != COLOR_ESCAPE_TIME ||
+		options.renderer == RENDERER_INVERSE)
+	{
+		fprintf(stderr, "Zoom mode only supports the escape-time renderer "
+				"with coloring by escape time.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+	if (options.kernel != KERNEL_AUTO || options.tileColumns != 0)
+	{
+		fprintf(stderr, "Zoom mode always uses the scalar kernel, so it does not "
+				"support --kernel or --tile.\n");
+
+		return UNKNOWN_OPTION_FAIL;
+	}
+
+	/*** Describe the strip. ***/
+	ZoomStrip strip;
+
+	strip.params.centerX = values[4];
+	strip.params.centerY = values[5];
+	strip.params.planeWidth = values[2];
+	strip.params.planeHeight = values[2] * windowHeight / windowWidth;
+	strip.params.C = values[6] + values[7] * I;
+	strip.params.windowWidth = windowWidth;
+	strip.params.windowHeight = windowHeight;
+	strip.params.numIterations = numIterations;
+	strip.params.map = options.map;
+	strip.params.coloring = COLOR_ESCAPE_TIME;
+	strip.params.renderer = RENDERER_ESCAPE_TIME;
+	strip.params.kernel = KERNEL_SCALAR;
+
+	/* One angle per pixel along the circle through the corners of a frame,
+	   and radii spaced by the same factor, so the samples are never farther
+	   apart than a pixel. The strip reaches from the corners of the widest
+	   frame in to ZOOM_CENTER_RADIUS pixels of the narrowest one. */
+	double minWidth = (values[2] < values[3]) ? values[2] : values[3];
+	double maxWidth = (values[2] < values[3]) ? values[3] : values[2];
+	double halfDiagonal = sqrt((double)windowWidth * windowWidth +
+							   (double)windowHeight * windowHeight) / 2.0;
+
+	strip.angles = (long)ceil(TWO_PI * halfDiagonal);
+	strip.angleStep = TWO_PI / strip.angles;
+	strip.logStep = strip.angleStep;
+	strip.logMinRadius = log(minWidth / windowWidth * ZOOM_CENTER_RADIUS);
+	strip.radii = (long)ceil((log(maxWidth / windowWidth * halfDiagonal) -
+							  strip.logMinRadius) / strip.logStep) + 1;
+
+	size_t stripSize = sizeof(Sint32) * strip.angles * strip.radii;
+
+	strip.counts = (Sint32*)allocateBuffer(stripSize);
+	strip.pixelRadius = (double*)malloc(sizeof(double) * windowWidth *
+										windowHeight);
+	strip.pixelAngle = (Sint32*)malloc(sizeof(Sint32) * windowWidth *
+									   windowHeight);
+
+	if (strip.counts == NULL || strip.pixelRadius == NULL ||
+		strip.pixelAngle == NULL)
+	{
+		fprintf(stderr, "Not enough memory for a strip of %ld x %ld points.\n",
+				strip.radii, strip.angles);
+
+		if (strip.counts != NULL)
+		{
+			freeBuffer(strip.counts, stripSize);
+		}
+		free(strip.pixelRadius);
+		free(strip.pixelAngle);
+
+		return ZOOM_WRITE_FAIL;
+	}
+
+	projectPixels(&strip, windowWidth, windowHeight);
+
+	SDL_Color **colorMap = newColorMap(windowWidth, windowHeight);
+	ZoomData dataList[numberOfThreads];
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		dataList[threadID].strip = &strip;
+		dataList[threadID].frame = strip.params;
+		dataList[threadID].threadID = threadID;
+		dataList[threadID].numberOfThreads = (int)numberOfThreads;
+		dataList[threadID].colorMap = colorMap;
+		dataList[threadID].directPoints = 0;
+	}
+
+	/*** Compute the strip. ***/
+	Uint32 startTime = SDL_GetTicks();
+	bool rendered = runZoomThreads(partialZoomStrip, dataList,
+								   numberOfThreads);
+
+	printf("Strip time: %dms\n", SDL_GetTicks() - startTime);
+
+	if (!rendered)
+	{
+		fprintf(stderr, "Not enough memory to compute the strip.\n");
+	}
+
+	/*** Reproject every frame from the strip. ***/
+	bool written = true;
+
+	for (long frame = 0; rendered && written && frame < numFrames; frame++)
+	{
+		double t = (numFrames > 1) ? (double)frame / (numFrames - 1) : 0.0;
+		double planeWidth = values[2] * pow(values[3] / values[2], t);
+
+		for (int threadID = 0; threadID < numberOfThreads; threadID++)
+		{
+			dataList[threadID].frame.planeWidth = planeWidth;
+			dataList[threadID].frame.planeHeight = planeWidth * windowHeight /
+												   windowWidth;
+		}
+
+		rendered = runZoomThreads(partialZoomFrame, dataList, numberOfThreads);
+
+		if (!rendered)
+		{
+			fprintf(stderr, "Not enough memory to render frame %ld.\n", frame);
+		}
+
+		char fileName[ZOOM_FILE_NAME_SIZE];
+
+		snprintf(fileName, sizeof(fileName), "%s%04ld.bmp", argv[12], frame);
+
+		written = rendered && writeColorMap(fileName, colorMap, windowWidth,
+											windowHeight);
+
+		if (rendered && !written)
+		{
+			fprintf(stderr, "Could not write '%s'.\n", fileName);
+		}
+	}
+
+	printf("Processing time: %dms\n", SDL_GetTicks() - startTime);
+
+	/* Compare the points computed with rendering every frame on its own. */
+	long computed = strip.angles * strip.radii;
+
+	for (int threadID = 0; threadID < numberOfThreads; threadID++)
+	{
+		computed += dataList[threadID].directPoints;
+	}
+
+	double perFrame = (double)numFrames * windowWidth * windowHeight;
+
+	printf("Computed %ld points instead of %.0f (%.1fx fewer).\n", computed,
+		   perFrame, perFrame / computed);
+
+	freeColorMap(colorMap, windowWidth, windowHeight);
+	freeBuffer(strip.counts, stripSize);
+	free(strip.pixelRadius);
+	free(strip.pixelAngle);
+
+	return (rendered && written) ? GET_ARGS_SUCCEED : ZOOM_WRITE_FAIL;
+}
@@ -0,0 +1,111 @@
+/**
+@file Zoom.h
+@author Rob Thomas
+@brief Contains functions for rendering a zoom video: a sequence of frames
+that zoom in on (or out of) a point of a Julia set.
+@details The frames are not rendered one by one. All of them show the plane
+around the same center, so every point is first computed once on a
+log-polar strip: row v and column u of the strip hold the point at angle
+v * angleStep and distance exp(logMinRadius + u * logStep) from the center.
+With logStep equal to angleStep the samples are spaced evenly in pixels at
+every zoom, so each frame is reprojected from the strip at no more than half a
+pixel of error. Only the few pixels closer to the center than the strip
+reaches are computed directly for each frame.
+
+Zooming only moves a pixel along the radius axis of the strip, so the angle
+and log-radius of every pixel are worked out once, and each frame takes its
+pixels from the strip at a fixed offset along that axis.
+*/
+
+#ifndef ZOOM_H
+#define ZOOM_H
+
+#include <SDL2/SDL.h>
+
+#include "HelperFunctions.h"
+
+
+/**
+@def ZOOM_WRITE_FAIL
+@brief Error code indicating that a zoom video could not be rendered or
+written to disk.
+*/
+#define ZOOM_WRITE_FAIL 11
+
+/**
+@def ZOOM_CENTER_RADIUS
+@brief The radius (in pixels of the most zoomed-in frame) of the patch around
+the center that is computed directly for each frame instead of being taken
+from the strip.
+*/
+#define ZOOM_CENTER_RADIUS 8
+
+
+/**
+@typedef ZoomStrip
+@brief The ZoomStrip struct holds the stages of the points of a log-polar
+strip around the center of a zoom video.
+@details pixelRadius[x * windowHeight + y] is the distance of pixel (x, y)
+from the center as the log-radius column of the strip it would fall on if
+pixels were one unit wide and the strip started at radius 1.
+pixelAngle[x * windowHeight + y] is the angle row it falls on.
+*/
+typedef struct ZoomStrip
+{
+	JuliaParams params;
+	Sint32 *counts;
+	long angles, radii;
+	double logMinRadius, logStep, angleStep;
+	double *pixelRadius;
+	Sint32 *pixelAngle;
+} ZoomStrip;
+
+/**
+@typedef ZoomData
+@brief The ZoomData struct is used for transmitting the strip and the frame
+being rendered to the threads that compute them.
+*/
+typedef struct ZoomData
+{
+	ZoomStrip *strip;
+	JuliaParams frame;
+	int threadID, numberOfThreads;
+	SDL_Color **colorMap;
+	long directPoints;
+} ZoomData;
+
+
+/**
+@fn partialZoomStrip
+@brief Computes the rows of the strip that belong to one thread.
+@param data A void pointer to be cast into a ZoomData struct.
+*/
+int partialZoomStrip (void *data);
+
+/**
+@fn partialZoomFrame
+@brief Fills the columns of a frame that belong to one thread, taking each
+pixel from the strip or computing it directly if it is too close to the
+center.
+@param data A void pointer to be cast into a ZoomData struct.
+*/
+int partialZoomFrame (void *data);
+
+/**
+@fn runZoom
+@brief Renders a zoom video and writes its frames to disk.
+@details runZoom() is called as
+	Project04_01 --zoom windowWidth windowHeight startWidth endWidth centerX
+						centerY a b numFrames numberOfThreads outputPrefix
+						[--map=NAME]
+where the width of the plane shown goes from startWidth in the first frame to
+endWidth in the last one, shrinking by the same factor every frame. Frame i
+is written to outputPrefix followed by i in four digits and ".bmp".
+@param argc The number of command line arguments passed in.
+@param argv The list of command line arguments (list of strings).
+@param numIterations The number of iterations to apply to each point.
+@return An error code. 0 if every frame was written.
+*/
+int runZoom (int argc, char *argv[], int numIterations);
+
+#endif /* ZOOM_H */